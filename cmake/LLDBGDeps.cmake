@@ -74,6 +74,9 @@ endif()
 set(OpenGL_GL_PREFERENCE "GLVND")
 find_package(OpenGL REQUIRED) # provides OpenGL::GL
 
+# ------------------------- Threads -------------------------------------------
+find_package(Threads REQUIRED) # provides Threads::Threads
+
 # ---- Dear ImGui -------------------------------------------------------------
 if(LLDBG_USE_SYSTEM_DEPS)
   find_package(imgui QUIET) # Debian/Ubuntu libimgui-dev
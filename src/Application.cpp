@@ -5,6 +5,7 @@
 #include "ImGuiFileDialog.h"
 #include "Log.hpp"
 #include "StringBuffer.hpp"
+#include "Timer.hpp"
 #include "fmt/format.h"
 #include "imgui_impl_glfw.h"
 #include "lldb/lldb-enumerations.h"
@@ -12,6 +13,7 @@
 #include <cassert>
 #include <cstdint>
 #include <filesystem>
+#include <string_view>
 
 namespace fs = std::filesystem;
 
@@ -38,37 +40,33 @@ static std::map<std::string, std::string> s_debug_stream;
 #define DEBUG_STREAM(x) void(x);
 #endif
 
-static std::pair<fs::path, size_t> get_stop_location_from_frame(const lldb::SBFrame& frame)
+static std::optional<std::pair<fs::path, size_t>>
+get_stop_location_from_frame(SourceMap& source_map, const lldb::SBFrame& frame)
 {
-    lldb::SBFileSpec spec = frame.GetLineEntry().GetFileSpec();
-    const char* filename = spec.GetFilename();
-    const char* directory = spec.GetDirectory();
+    lldb::SBLineEntry line_entry = frame.GetLineEntry();
+    std::optional<fs::path> filepath = source_map.resolve(line_entry.GetFileSpec());
 
-    if (!fs::exists(directory))
+    if (!filepath.has_value())
     {
-        LOG(Warning) << "Unable to open file, no file";
-        return {fs::path(), -1};
+        return {};
     }
 
-    return {fs::path(directory) / fs::path(filename), (int) frame.GetLineEntry().GetLine()};
+    return std::make_pair(std::move(*filepath), size_t(line_entry.GetLine()));
 }
 
-static std::pair<fs::path, int> resolve_breakpoint(lldb::SBBreakpointLocation location)
+static std::optional<std::pair<fs::path, int>>
+resolve_breakpoint(SourceMap& source_map, lldb::SBBreakpointLocation location)
 {
     lldb::SBAddress address = location.GetAddress();
     lldb::SBLineEntry line_entry = address.GetLineEntry();
-    const char* filename = line_entry.GetFileSpec().GetFilename();
-    const char* directory = line_entry.GetFileSpec().GetDirectory();
+    std::optional<fs::path> filepath = source_map.resolve(line_entry.GetFileSpec());
 
-    if (filename == nullptr || directory == nullptr)
-    {
-        LOG(Error) << "Failed to read breakpoint location after thread halted";
-        return {fs::path(), -1};
-    }
-    else
+    if (!filepath.has_value())
     {
-        return {fs::path(directory) / fs::path(filename), line_entry.GetLine()};
+        return {};
     }
+
+    return std::make_pair(std::move(*filepath), int(line_entry.GetLine()));
 }
 
 static std::pair<bool, bool> process_is_finished(lldb::SBProcess& process)
@@ -85,10 +83,24 @@ static std::pair<bool, bool> process_is_finished(lldb::SBProcess& process)
     return {exited || failed, !failed};
 }
 
-static void set_thread_frame_indices(UserInterface& ui, uint32_t idx)
+static void
+set_thread_frame_indices(UserInterface& ui, uint32_t thread_index_id, uint32_t frame_idx)
+{
+    ui.viewed_thread_index_id = thread_index_id;
+    ui.viewed_frame_index = frame_idx;
+}
+
+// The thread shown by the stack trace, locals and registers. Once it has exited
+// the view moves to lldb's selected thread.
+static lldb::SBThread find_viewed_thread(lldb::SBProcess& process, UserInterface& ui)
 {
-    ui.viewed_thread_index = idx;
-    ui.viewed_frame_index = idx;
+    lldb::SBThread thread = process.GetThreadByIndexID(ui.viewed_thread_index_id);
+    if (!thread.IsValid())
+    {
+        thread = process.GetSelectedThread();
+        set_thread_frame_indices(ui, thread.GetIndexID(), 0);
+    }
+    return thread;
 }
 
 static bool process_is_running(lldb::SBProcess& process)
@@ -189,6 +201,14 @@ static std::optional<lldb::SBProcess> find_process(lldb::SBDebugger& debugger)
     }
 }
 
+// lldb holds the target's API mutex while evaluating an expression or running a
+// console command in the background, and the sampler interrupts and resumes the
+// process from its own thread: the UI mustn't touch lldb meanwhile.
+static bool lldb_is_busy(const Application& app)
+{
+    return app.expressions.is_busy() || app.sampler.is_active() || app.cmdline.is_running();
+}
+
 static void kill_process(lldb::SBProcess& process)
 {
     if (!process.IsValid())
@@ -212,11 +232,6 @@ static void kill_process(lldb::SBProcess& process)
     }
 }
 
-static std::string build_string(const char* cstr)
-{
-    return cstr != nullptr ? std::string(cstr) : std::string();
-}
-
 static void glfw_error_callback(int error, const char* description)
 {
     StringBuffer buffer;
@@ -224,52 +239,6 @@ static void glfw_error_callback(int error, const char* description)
     LOG(Error) << buffer.data();
 }
 
-// A convenience struct for extracting pertinent display information from an
-// lldb::SBFrame
-struct StackFrame
-{
-    FileHandle file_handle;
-    std::string function_name;
-    int line;
-    int column;
-
-  private:
-    StackFrame(FileHandle _file_handle, int _line, int _column, std::string&& _function_name)
-        : file_handle(_file_handle), function_name(std::move(_function_name)), line(_line),
-          column(_column)
-    {
-    }
-
-  public:
-    static std::optional<StackFrame> create(lldb::SBFrame frame)
-    {
-        lldb::SBFileSpec spec = frame.GetLineEntry().GetFileSpec();
-        fs::path filename = fs::path(build_string(spec.GetFilename()));
-        fs::path directory = fs::path(build_string(spec.GetDirectory()));
-
-        if (!fs::exists(directory))
-        {
-            // LOG(Warning) << "Directory specified by lldb stack frame doesn't exist:
-            // " << directory; LOG(Warning) << "Filepath specified: " << filename;
-            return {};
-        }
-
-        if (auto handle = FileHandle::create(directory / filename); handle.has_value())
-        {
-            return StackFrame(
-                *handle, (int) frame.GetLineEntry().GetLine(),
-                (int) frame.GetLineEntry().GetColumn(), build_string(frame.GetDisplayFunctionName())
-            );
-        }
-        else
-        {
-            LOG(Warning) << "Filepath corresponding to lldb stack frame doesn't exist: "
-                         << directory / filename;
-            return {};
-        }
-    }
-};
-
 static bool FileTreeNode(const char* label)
 {
     ImGuiContext& g = *GImGui;
@@ -377,6 +346,15 @@ static void draw_open_files(Application& app)
                     app.file_viewer.show(handle);
                 }
                 std::optional<int> clicked_line = app.file_viewer.render();
+
+                // toggling a breakpoint queries the target and runs a command, which
+                // would block on the API mutex (and then be refused) while lldb is busy
+                if (clicked_line.has_value() && lldb_is_busy(app))
+                {
+                    LOG(Warning) << "lldb is busy, breakpoints can't be toggled right now";
+                    clicked_line = {};
+                }
+
                 if (clicked_line.has_value())
                 {
                     std::optional<FileHandle> focus_handle = app.open_files.focus();
@@ -404,8 +382,9 @@ static void draw_open_files(Application& app)
 
                             lldb::SBBreakpointLocation location = breakpoint.GetLocationAtIndex(0);
 
-                            auto [location_filepath, location_line] = resolve_breakpoint(location);
-                            if (location_filepath == filepath && location_line == *clicked_line)
+                            const auto resolved = resolve_breakpoint(app.source_map, location);
+                            if (resolved.has_value() && resolved->first == filepath &&
+                                resolved->second == *clicked_line)
                             {
                                 breakpoint_exists = true;
                                 breakpoint_id = breakpoint.GetID();
@@ -511,18 +490,12 @@ static void draw_file_browser(Application& app, FileBrowserNode* node_to_draw, s
     }
 }
 
-static lldb::SBCommandReturnObject run_lldb_command(
-    lldb::SBDebugger& debugger, LLDBCommandLine& cmdline, const lldb::SBListener& listener,
-    const char* command, bool hide_from_history = false
+// Listens to a newly created or selected target, and logs how the command went.
+static void after_lldb_command(
+    lldb::SBDebugger& debugger, const lldb::SBListener& listener,
+    const std::optional<lldb::SBTarget>& target_before, lldb::SBCommandReturnObject& ret
 )
 {
-    if (auto unaliased_cmd = cmdline.expand_and_unalias_command(command); unaliased_cmd.has_value())
-    {
-        LOG(Debug) << "Unaliased command: " << *unaliased_cmd;
-    }
-
-    auto target_before = find_target(debugger);
-    lldb::SBCommandReturnObject ret = cmdline.run_command(command, hide_from_history);
     auto target_after = find_target(debugger);
 
     const bool added_new_target = !target_before && target_after;
@@ -530,41 +503,60 @@ static lldb::SBCommandReturnObject run_lldb_command(
 
     if (added_new_target || switched_target)
     {
-        constexpr auto target_listen_flags = lldb::SBTarget::eBroadcastBitBreakpointChanged |
-                                             lldb::SBTarget::eBroadcastBitWatchpointChanged;
+        constexpr auto target_listen_flags =
+            lldb::SBTarget::eBroadcastBitBreakpointChanged |
+            lldb::SBTarget::eBroadcastBitWatchpointChanged |
+            lldb::SBTarget::eBroadcastBitModulesLoaded |
+            lldb::SBTarget::eBroadcastBitModulesUnloaded |
+            lldb::SBTarget::eBroadcastBitSymbolsLoaded;
         target_after->GetBroadcaster().AddListener(listener, target_listen_flags);
     }
 
     switch (ret.GetStatus())
     {
     case lldb::eReturnStatusInvalid:
-        LOG(Debug) << "\t => eReturnStatusInvalid";
+        LOG_CAT(Debug, Lldb) << "\t => eReturnStatusInvalid";
         break;
     case lldb::eReturnStatusSuccessFinishNoResult:
-        LOG(Debug) << "\t => eReturnStatusSuccessFinishNoResult";
+        LOG_CAT(Debug, Lldb) << "\t => eReturnStatusSuccessFinishNoResult";
         break;
     case lldb::eReturnStatusSuccessFinishResult:
-        LOG(Debug) << "\t => eReturnStatusSuccessFinishResult";
+        LOG_CAT(Debug, Lldb) << "\t => eReturnStatusSuccessFinishResult";
         break;
     case lldb::eReturnStatusSuccessContinuingNoResult:
-        LOG(Debug) << "\t => eReturnStatusSuccessContinuingNoResult";
+        LOG_CAT(Debug, Lldb) << "\t => eReturnStatusSuccessContinuingNoResult";
         break;
     case lldb::eReturnStatusSuccessContinuingResult:
-        LOG(Debug) << "\t => eReturnStatusSuccessContinuingResult";
+        LOG_CAT(Debug, Lldb) << "\t => eReturnStatusSuccessContinuingResult";
         break;
     case lldb::eReturnStatusStarted:
-        LOG(Debug) << "\t => eReturnStatusStarted";
+        LOG_CAT(Debug, Lldb) << "\t => eReturnStatusStarted";
         break;
     case lldb::eReturnStatusFailed:
-        LOG(Debug) << "\t => eReturnStatusFailed";
+        LOG_CAT(Debug, Lldb) << "\t => eReturnStatusFailed";
         break;
     case lldb::eReturnStatusQuit:
-        LOG(Debug) << "\t => eReturnStatusQuit";
+        LOG_CAT(Debug, Lldb) << "\t => eReturnStatusQuit";
         break;
     default:
-        LOG(Debug) << "unknown lldb command return status encountered.";
+        LOG_CAT(Debug, Lldb) << "unknown lldb command return status encountered.";
         break;
     }
+}
+
+static lldb::SBCommandReturnObject run_lldb_command(
+    lldb::SBDebugger& debugger, LLDBCommandLine& cmdline, const lldb::SBListener& listener,
+    const char* command, bool hide_from_history = false
+)
+{
+    if (auto unaliased_cmd = cmdline.expand_and_unalias_command(command); unaliased_cmd.has_value())
+    {
+        LOG_CAT(Debug, Lldb) << "Unaliased command: " << *unaliased_cmd;
+    }
+
+    auto target_before = find_target(debugger);
+    lldb::SBCommandReturnObject ret = cmdline.run_command(command, hide_from_history);
+    after_lldb_command(debugger, listener, target_before, ret);
 
     return ret;
 }
@@ -572,12 +564,68 @@ static lldb::SBCommandReturnObject run_lldb_command(
 lldb::SBCommandReturnObject
 run_lldb_command(Application& app, const char* command, bool hide_from_history)
 {
-    return run_lldb_command(app.debugger, app.cmdline, app.listener, command, hide_from_history);
+    lldb::SBCommandReturnObject ret =
+        run_lldb_command(app.debugger, app.cmdline, app.listener, command, hide_from_history);
+
+    // any command may have changed target.source-map ('settings set', 'command source', ...)
+    app.source_map.synchronize(app.cmdline);
+
+    return ret;
+}
+
+// Runs a command typed into the console in the background, streaming its output.
+static void start_console_command(Application& app, const char* command)
+{
+    if (auto unaliased_cmd = app.cmdline.expand_and_unalias_command(command);
+        unaliased_cmd.has_value())
+    {
+        LOG_CAT(Debug, Lldb) << "Unaliased command: " << *unaliased_cmd;
+    }
+
+    app.cmdline.start_command(command);
+}
+
+// Moves new output of the background console command into the console, and
+// finishes up after it like run_lldb_command does once it is done.
+static void poll_console_command(Application& app)
+{
+    std::optional<lldb::SBCommandReturnObject> ret = app.cmdline.poll();
+    if (!ret.has_value())
+    {
+        return;
+    }
+
+    // the target from before the command isn't known here, but adding the
+    // listener to a target again only merges the event masks
+    after_lldb_command(app.debugger, app.listener, std::nullopt, *ret);
+    app.source_map.synchronize(app.cmdline);
+}
+
+static void draw_sampler_status(Sampler& sampler)
+{
+    const SamplerStats stats = sampler.stats();
+
+    StringBuffer buf;
+    buf.format("{} samples, {} unique stacks", stats.samples, stats.unique_stacks);
+    ImGui::TextUnformatted(buf.data());
+    buf.clear();
+
+    // the share of wall-clock time the process spent interrupted
+    const double overhead =
+        stats.elapsed_ns > 0 ? 100.0 * double(stats.paused_ns) / double(stats.elapsed_ns) : 0.0;
+    const uint64_t mean_pause_us =
+        stats.interrupts > 0 ? stats.paused_ns / stats.interrupts / 1000 : 0;
+    buf.format(
+        "overhead {:.1f}% (pause: mean {} us, max {} us)", overhead, mean_pause_us,
+        stats.max_pause_ns / 1000
+    );
+    ImGui::TextUnformatted(buf.data());
+    buf.clear();
 }
 
 static void draw_control_bar(
     lldb::SBDebugger& debugger, LLDBCommandLine& cmdline, const lldb::SBListener& listener,
-    const UserInterface& ui
+    const UserInterface& ui, Sampler& sampler, FlameGraph& flame_graph
 )
 {
     auto target = find_target(debugger);
@@ -663,8 +711,8 @@ static void draw_control_bar(
         {
             const uint32_t nthreads = process->GetNumThreads();
             /*
-            if (ui.viewed_thread_index < nthreads) {
-                lldb::SBThread th = process->GetThreadAtIndex(ui.viewed_thread_index);
+            lldb::SBThread th = process->GetThreadByIndexID(ui.viewed_thread_index_id);
+            if (th.IsValid()) {
                 th.StepOver();
             }
             */
@@ -678,8 +726,8 @@ static void draw_control_bar(
         {
             const uint32_t nthreads = process->GetNumThreads();
             /*
-            if (ui.viewed_thread_index < nthreads) {
-                lldb::SBThread th = process->GetThreadAtIndex(ui.viewed_thread_index);
+            lldb::SBThread th = process->GetThreadByIndexID(ui.viewed_thread_index_id);
+            if (th.IsValid()) {
                 th.StepInto();
             }
             */
@@ -697,10 +745,9 @@ static void draw_control_bar(
         ImGui::SameLine();
         if (ImGui::Button("step out"))
         {
-            const uint32_t nthreads = process->GetNumThreads();
-            if (ui.viewed_thread_index < nthreads)
+            lldb::SBThread th = process->GetThreadByIndexID(ui.viewed_thread_index_id);
+            if (th.IsValid())
             {
-                lldb::SBThread th = process->GetThreadAtIndex(ui.viewed_thread_index);
                 th.StepOut();
             }
         }
@@ -716,6 +763,18 @@ static void draw_control_bar(
         {
             stop_process(*process);
         }
+
+        static int sample_rate_hz = 50;
+        static bool sample_running_only = false;
+        ImGui::SameLine();
+        if (ImGui::Button("sample"))
+        {
+            sampler.start(*process, uint32_t(sample_rate_hz), sample_running_only);
+        }
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(ImGui::CalcTextSize("00000").x);
+        ImGui::DragInt("Hz", &sample_rate_hz, 1.f, 1, 1000);
+        ImGui::Checkbox("running threads only", &sample_running_only);
     }
     else if (const auto [finished, _] = process_is_finished(*process); finished)
     {
@@ -728,6 +787,17 @@ static void draw_control_bar(
     {
         LOG(Error) << "Unknown/Invalid session state encountered!";
     }
+
+    if (sampler.stats().ticks > 0)
+    {
+        ImGui::TextUnformatted("Last profile:");
+        draw_sampler_status(sampler);
+    }
+
+    if (ImGui::Button("flame graph"))
+    {
+        flame_graph.open();
+    }
 }
 
 static void draw_file_viewer(Application& app)
@@ -755,6 +825,243 @@ static void draw_file_viewer(Application& app)
     ImGui::EndChild();
 }
 
+static void draw_disassembly(Application& app)
+{
+    if (lldb_is_busy(app))
+    {
+        return;
+    }
+
+    auto process = find_process(app.debugger);
+    if (!process.has_value() || !process_is_stopped(*process))
+    {
+        return;
+    }
+
+    lldb::SBThread viewed_thread = find_viewed_thread(*process, app.ui);
+    lldb::SBFrame frame = viewed_thread.GetFrameAtIndex(app.ui.viewed_frame_index);
+    if (!viewed_thread.IsValid() || !frame.IsValid())
+    {
+        return;
+    }
+
+    const DisassembledFunction* function = app.disassembly.get(*process, frame);
+    if (function == nullptr)
+    {
+        ImGui::TextUnformatted("No disassembly available for the selected frame.");
+        return;
+    }
+
+    const lldb::addr_t pc = frame.GetPCAddress().GetLoadAddress(process->GetTarget());
+    const std::optional<size_t> pc_index = function->find_instruction(pc);
+
+    ImGui::TextUnformatted(function->name.c_str());
+    ImGui::Separator();
+
+    ImGui::BeginChild("DisassemblyInstructions");
+
+    // only jump to the PC when it changes, so the user can scroll around freely
+    static lldb::addr_t last_scrolled_pc = LLDB_INVALID_ADDRESS;
+    if (pc_index.has_value() && pc != last_scrolled_pc)
+    {
+        const float line_height = ImGui::GetTextLineHeightWithSpacing();
+        ImGui::SetScrollY(
+            std::max(0.f, float(*pc_index) * line_height - 0.5f * ImGui::GetWindowHeight())
+        );
+        last_scrolled_pc = pc;
+    }
+
+    ImGuiListClipper clipper;
+    clipper.Begin(int(function->instructions.size()));
+    while (clipper.Step())
+    {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+        {
+            const DisassembledInstruction& inst = function->instructions[size_t(i)];
+            const bool is_pc = pc_index.has_value() && *pc_index == size_t(i);
+            ImGui::Selectable(inst.text.c_str(), is_pc);
+        }
+    }
+    clipper.End();
+
+    ImGui::EndChild();
+}
+
+static void draw_trace(Tracepoints& tracepoints)
+{
+    StringBuffer status;
+    status.format_(
+        "{} records, {:.0f}/s", tracepoints.total_records(), tracepoints.records_per_second()
+    );
+    if (tracepoints.dropped_records() > 0)
+    {
+        status.format_(", {} dropped (trace buffer full)", tracepoints.dropped_records());
+    }
+    status.push_back('\0');
+    ImGui::TextUnformatted(status.data());
+    ImGui::SameLine();
+    if (ImGui::SmallButton("clear"))
+    {
+        tracepoints.clear_history();
+    }
+
+    ImGui::BeginChild("TraceRecords");
+
+    // only the visible records are formatted, however many hits there are
+    ImGuiListClipper clipper;
+    clipper.Begin(int(tracepoints.history_size()));
+    StringBuffer line;
+    while (clipper.Step())
+    {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+        {
+            const TraceRecord& record = tracepoints.record(size_t(i));
+            const Tracepoint& tracepoint = *tracepoints.tracepoints()[record.tracepoint];
+
+            line.clear();
+            line.format_(
+                "{:>12.6f}  thread {:<4} {}", double(record.timestamp_ns) / 1e9,
+                record.thread_index_id, tracepoint.location
+            );
+            for (uint32_t v = 0; v < record.nvalues; v++)
+            {
+                line.format_("  {} = {}", tracepoint.expressions[v], record.values[v].data());
+            }
+            line.push_back('\0');
+            ImGui::TextUnformatted(line.data());
+        }
+    }
+    clipper.End();
+
+    // follow new records, unless the user scrolled up to look at older ones
+    // (the history stops growing once full, the total keeps counting)
+    static uint64_t last_total_records = 0;
+    if (tracepoints.total_records() != last_total_records &&
+        ImGui::GetScrollY() >= ImGui::GetScrollMaxY())
+    {
+        ImGui::SetScrollHereY(1.0f);
+    }
+    last_total_records = tracepoints.total_records();
+
+    ImGui::EndChild();
+}
+
+// The console's input line, kept across frames.
+struct ConsoleInput
+{
+    std::array<char, 2048> buffer = {};
+    CommandHistory* history = nullptr;
+    std::optional<size_t> recalled; // the history entry in the buffer, if any
+
+    // Ctrl-R reverse search
+    bool searching = false;
+    bool focus_search = false;
+    std::array<char, 256> query = {};
+    std::optional<size_t> match;
+};
+
+// Up/down arrows step through the command history.
+static int console_input_callback(ImGuiInputTextCallbackData* data)
+{
+    auto& input = *static_cast<ConsoleInput*>(data->UserData);
+    if (data->EventFlag != ImGuiInputTextFlags_CallbackHistory)
+    {
+        return 0;
+    }
+
+    if (data->EventKey == ImGuiKey_DownArrow && input.recalled == size_t(0))
+    {
+        // past the newest command, back to an empty line
+        data->DeleteChars(0, data->BufTextLen);
+        input.recalled.reset();
+        return 0;
+    }
+
+    std::optional<size_t> next = {};
+    if (data->EventKey == ImGuiKey_UpArrow)
+    {
+        next = input.recalled.has_value() ? *input.recalled + 1 : 0;
+    }
+    else if (data->EventKey == ImGuiKey_DownArrow && input.recalled.has_value())
+    {
+        next = *input.recalled - 1;
+    }
+
+    if (!next.has_value())
+    {
+        return 0;
+    }
+
+    const std::optional<std::string_view> command = input.history->entry(*next);
+    if (command.has_value()) // otherwise already at the oldest command
+    {
+        data->DeleteChars(0, data->BufTextLen);
+        data->InsertChars(0, command->data(), command->data() + command->size());
+        input.recalled = next;
+    }
+
+    return 0;
+}
+
+// Replaces the console input line while searching: Ctrl-R again goes to the
+// next older match, enter takes the match into the input line and escape
+// (or clicking away) cancels.
+static void draw_history_search(ConsoleInput& input)
+{
+    if (input.focus_search)
+    {
+        ImGui::SetKeyboardFocusHere(0);
+        input.focus_search = false;
+    }
+
+    const bool accept = ImGui::InputText(
+        "reverse-i-search", input.query.data(), input.query.size(),
+        ImGuiInputTextFlags_EnterReturnsTrue
+    );
+    const std::string_view query = input.query.data();
+
+    if (ImGui::IsItemEdited())
+    {
+        input.match = query.empty() ? std::nullopt : input.history->search(query, 0);
+    }
+
+    if (ImGui::IsItemActive() && ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_R, false) &&
+        input.match.has_value())
+    {
+        if (const std::optional<size_t> older = input.history->search(query, *input.match + 1))
+        {
+            input.match = older;
+        }
+    }
+
+    const bool deactivated = ImGui::IsItemDeactivated();
+
+    const std::optional<std::string_view> command =
+        input.match.has_value() ? input.history->entry(*input.match) : std::nullopt;
+    ImGui::SameLine();
+    if (command.has_value())
+    {
+        ImGui::TextUnformatted(command->data(), command->data() + command->size());
+    }
+    else if (!query.empty())
+    {
+        ImGui::TextDisabled("no match");
+    }
+
+    if (accept && command.has_value())
+    {
+        const size_t length = std::min(command->size(), input.buffer.size() - 1);
+        input.buffer.fill(0);
+        std::copy_n(command->data(), length, input.buffer.data());
+        input.recalled = input.match;
+    }
+
+    if (accept || deactivated)
+    {
+        input.searching = false;
+    }
+}
+
 static void draw_console(Application& app)
 {
     ImGui::BeginChild(
@@ -769,60 +1076,106 @@ static void draw_console(Application& app)
         {
             ImGui::BeginChild("ConsoleEntries");
 
-            for (const CommandLineEntry& entry : app.cmdline.get_history())
+            // only the lines in view are drawn, every line is one text row high
+            const ConsoleHistory& history = app.cmdline.get_history();
+            ImGuiListClipper clipper;
+            clipper.Begin(int(history.line_count()));
+            while (clipper.Step())
             {
-                ImGui::TextColored(ImVec4(255, 0, 0, 255), "> %s", entry.input.c_str());
-                if (!entry.succeeded)
-                {
-                    ImGui::Text("error: %s is not a valid command.", entry.input.c_str());
-                    continue;
-                }
-
-                if (entry.output.size() > 0)
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
                 {
-                    ImGui::TextUnformatted(entry.output.c_str());
+                    const std::string_view text = history.text(size_t(i));
+                    const bool is_input = history.kind(size_t(i)) == ConsoleLineKind::Input;
+                    if (is_input)
+                    {
+                        ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(255, 0, 0, 255));
+                    }
+                    ImGui::TextUnformatted(text.data(), text.data() + text.size());
+                    if (is_input)
+                    {
+                        ImGui::PopStyleColor();
+                    }
                 }
             }
-
-            // later in this method we scroll to the bottom of the command history if
-            // a command was run last frame, so that the user can immediately see the
-            // output.
+            clipper.End();
+
+            // later in this method we scroll to the bottom of the command history, so
+            // that the user immediately sees the output of a command they just ran, and
+            // keeps following what a running command streams in (unless they scrolled
+            // up to look at older lines).
+            static size_t last_line_count = 0;
+            const bool output_grew = history.line_count() != last_line_count &&
+                                     ImGui::GetScrollY() >= ImGui::GetScrollMaxY();
+            last_line_count = history.line_count();
             const bool should_auto_scroll_command_window =
-                app.ui.ran_command_last_frame || app.ui.window_resized_last_frame;
-
-            auto command_input_callback = [](ImGuiInputTextCallbackData*) -> int
-            {
-                return 0; // TODO: scroll command line history with up/down arrows
-            };
+                app.ui.ran_command_last_frame || app.ui.window_resized_last_frame || output_grew;
 
-            const ImGuiInputTextFlags command_input_flags = ImGuiInputTextFlags_EnterReturnsTrue;
+            static ConsoleInput input;
+            input.history = &app.command_history;
 
-            // keep console input focused unless user is doing something else
-            if (ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows) &&
-                !ImGui::IsAnyItemActive() && !ImGui::IsMouseClicked(0))
+            if (input.searching)
             {
-                ImGui::SetKeyboardFocusHere(0);
+                draw_history_search(input);
             }
-
-            // TODO: resize input_buf when necessary?
-            std::array<char, 2048> input_buf = {};
-            if (ImGui::InputText(
-                    "lldb console", input_buf.data(), 2048, command_input_flags,
-                    command_input_callback
-                ))
+            else
             {
-                run_lldb_command(app, input_buf.data());
-                input_buf.fill(0);
-                input_buf[0] = '\0';
-                app.ui.ran_command_last_frame = true;
-            }
+                const ImGuiInputTextFlags command_input_flags =
+                    ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_CallbackHistory;
 
-            // Always keep keyboard input focused on the lldb console input box unless
-            // some other disrupting action is occuring
-            if (ImGui::IsItemHovered() || (ImGui::IsWindowFocused(ImGuiFocusedFlags_RootWindow) &&
-                                           !ImGui::IsAnyItemActive() && !ImGui::IsMouseClicked(0)))
-            {
-                ImGui::SetKeyboardFocusHere(-1); // Auto focus previous widget
+                // keep console input focused unless user is doing something else
+                if (ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows) &&
+                    !ImGui::IsAnyItemActive() && !ImGui::IsMouseClicked(0))
+                {
+                    ImGui::SetKeyboardFocusHere(0);
+                }
+
+                // running a command while an expression is evaluated would block the
+                // UI, and while sampling it would race with the sampler
+                const bool lldb_busy = lldb_is_busy(app);
+
+                if (app.cmdline.is_running())
+                {
+                    ImGui::TextDisabled("running '%s'...", app.cmdline.running_command().c_str());
+                    ImGui::SameLine();
+                    if (ImGui::SmallButton("interrupt"))
+                    {
+                        app.cmdline.interrupt();
+                    }
+                }
+
+                // TODO: resize input buffer when necessary?
+                ImGui::BeginDisabled(lldb_busy);
+                if (ImGui::InputText(
+                        "lldb console", input.buffer.data(), input.buffer.size(),
+                        command_input_flags, console_input_callback, &input
+                    ))
+                {
+                    app.command_history.add(input.buffer.data());
+                    start_console_command(app, input.buffer.data());
+                    input.buffer.fill(0);
+                    input.recalled.reset();
+                    app.ui.ran_command_last_frame = true;
+                }
+                const bool start_search = ImGui::IsItemActive() && ImGui::GetIO().KeyCtrl &&
+                                          ImGui::IsKeyPressed(ImGuiKey_R, false);
+                ImGui::EndDisabled();
+
+                // Always keep keyboard input focused on the lldb console input box unless
+                // some other disrupting action is occuring
+                if (ImGui::IsItemHovered() ||
+                    (ImGui::IsWindowFocused(ImGuiFocusedFlags_RootWindow) &&
+                     !ImGui::IsAnyItemActive() && !ImGui::IsMouseClicked(0)))
+                {
+                    ImGui::SetKeyboardFocusHere(-1); // Auto focus previous widget
+                }
+
+                if (start_search)
+                {
+                    input.searching = true;
+                    input.focus_search = true;
+                    input.query.fill(0);
+                    input.match.reset();
+                }
             }
 
             if (should_auto_scroll_command_window)
@@ -838,68 +1191,7 @@ static void draw_console(Application& app)
 
         if (ImGui::BeginTabItem("log"))
         {
-            ImGui::BeginChild("LogEntries");
-            Logger::get_instance()->for_each_message(
-                [](const LogMessage& entry) -> void
-                {
-                    const char* msg = entry.message.c_str();
-                    switch (entry.level)
-                    {
-                    case LogLevel::Verbose:
-                    {
-                        ImGui::TextColored(
-                            ImVec4(78.f / 255.f, 78.f / 255.f, 78.f / 255.f, 255.f), "[VERBOSE]"
-                        );
-                        break;
-                    }
-                    case LogLevel::Debug:
-                    {
-                        ImGui::TextColored(
-                            ImVec4(52.f / 255.f, 56.f / 255.f, 176.f / 255.f, 255.f / 255.f),
-                            "[DEBUG]"
-                        );
-                        break;
-                    }
-                    case LogLevel::Info:
-                    {
-                        ImGui::TextColored(
-                            ImVec4(225.f / 255.f, 225.f / 255.f, 225.f / 255.f, 255.f / 255.f),
-                            "[INFO]"
-                        );
-                        break;
-                    }
-                    case LogLevel::Warning:
-                    {
-                        ImGui::TextColored(
-                            ImVec4(216.f / 255.f, 129.f / 255.f, 42.f / 255.f, 255.f / 255.f),
-                            "[WARNING]"
-                        );
-                        break;
-                    }
-                    case LogLevel::Error:
-                    {
-                        ImGui::TextColored(
-                            ImVec4(212.f / 255.f, 67.f / 255.f, 67.f / 255.f, 255.f / 255.f),
-                            "[ERROR]"
-                        );
-                        break;
-                    }
-                    }
-                    ImGui::SameLine();
-                    ImGui::TextWrapped("%s", msg);
-                }
-            );
-
-            static size_t last_seen_messages = 0;
-
-            const size_t seen_messages = Logger::get_instance()->message_count();
-            if (seen_messages > last_seen_messages)
-            {
-                last_seen_messages = seen_messages;
-                ImGui::SetScrollHereY(1.0f);
-            }
-
-            ImGui::EndChild();
+            app.log_view.render();
             ImGui::EndTabItem();
         }
 
@@ -936,13 +1228,79 @@ static void draw_console(Application& app)
             ImGui::EndTabItem();
         }
 
+        if (ImGui::BeginTabItem("trace"))
+        {
+            draw_trace(app.tracepoints);
+            ImGui::EndTabItem();
+        }
+
+        if (ImGui::BeginTabItem("disassembly"))
+        {
+            ImGui::BeginChild("DisassemblyEntries");
+            draw_disassembly(app);
+            ImGui::EndChild();
+            ImGui::EndTabItem();
+        }
+
         ImGui::EndTabBar();
     }
     ImGui::EndChild();
 }
 
-static void
-draw_threads(UserInterface& ui, std::optional<lldb::SBProcess> process, float stack_height)
+static void draw_stack_group(UserInterface& ui, const StackGroups& groups, uint32_t index)
+{
+    // chains of frames shared by exactly the same threads are shown as a single node
+    uint32_t last = index;
+    while (groups.nodes[last].children.size() == 1 && groups.nodes[last].threads.empty())
+    {
+        last = groups.nodes[last].children.front();
+    }
+
+    const StackNode& top = groups.nodes[last];
+
+    StringBuffer buf;
+    buf.format("[{}] {}##StackGroup_{}", top.thread_count, top.function_name, index);
+    if (!ImGui::TreeNode(buf.data()))
+    {
+        return;
+    }
+    Defer(ImGui::TreePop());
+    buf.clear();
+
+    // innermost frame first, like the stack trace
+    for (uint32_t n = last;; n = groups.nodes[n].parent)
+    {
+        ImGui::TextDisabled("%s", groups.nodes[n].function_name.c_str());
+        if (n == index)
+        {
+            break;
+        }
+    }
+
+    for (const uint32_t t : top.threads)
+    {
+        const StackThread& thread = groups.threads[t];
+        buf.format(
+            "thread #{} (tid {}){}##StackThread_{}", thread.index_id, thread.id,
+            thread.truncated ? " [truncated]" : "", thread.id
+        );
+        if (ImGui::Selectable(buf.data(), thread.index_id == ui.viewed_thread_index_id))
+        {
+            set_thread_frame_indices(ui, thread.index_id, 0);
+        }
+        buf.clear();
+    }
+
+    for (const uint32_t child : top.children)
+    {
+        draw_stack_group(ui, groups, child);
+    }
+}
+
+static void draw_threads(
+    UserInterface& ui, ThreadList& threads, ParallelStacks& parallel_stacks,
+    std::optional<lldb::SBProcess> process, bool show_last_stop, float stack_height
+)
 {
     ImGui::BeginChild(
         "#ThreadsChild",
@@ -954,49 +1312,149 @@ draw_threads(UserInterface& ui, std::optional<lldb::SBProcess> process, float st
     Defer(ImGui::EndChild());
 
     // TODO: be consistent about whether or not to use Defer
-    // TODO: add columns with stop reason and other potential information
     if (ImGui::BeginTabBar("#ThreadsTabs", ImGuiTabBarFlags_None))
     {
         Defer(ImGui::EndTabBar());
         if (ImGui::BeginTabItem("threads"))
         {
             Defer(ImGui::EndTabItem());
-            if (process.has_value() && process_is_stopped(*process))
+            const bool live = process.has_value() && process_is_stopped(*process);
+            if (live || show_last_stop)
             {
-                const uint32_t nthreads = process->GetNumThreads();
-
-                if (ui.viewed_thread_index >= nthreads)
+                if (live)
                 {
-                    ui.viewed_thread_index = nthreads - 1;
-                    LOG(Warning) << "detected/fixed overflow of ui.viewed_thread_index";
+                    threads.synchronize(*process);
                 }
 
-                StringBuffer thread_label;
-                for (uint32_t i = 0; i < nthreads; i++)
+                StringBuffer summary;
+                summary.format(
+                    "{} threads, {} with a stop reason", threads.size(), threads.stopped().size()
+                );
+                ImGui::TextUnformatted(summary.data());
+
+                static std::array<char, 128> filter_buf = {};
+                static bool stopped_only = false;
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x / 2);
+                ImGui::InputTextWithHint(
+                    "##ThreadsFilter", "filter", filter_buf.data(), filter_buf.size()
+                );
+                ImGui::SameLine();
+                ImGui::Checkbox("stopped only", &stopped_only);
+                threads.set_filter(filter_buf.data(), stopped_only);
+
+                static constexpr ImGuiTableFlags table_flags =
+                    ImGuiTableFlags_Sortable | ImGuiTableFlags_ScrollY | ImGuiTableFlags_ScrollX |
+                    ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersV | ImGuiTableFlags_Resizable |
+                    ImGuiTableFlags_SizingFixedFit;
+
+                if (ImGui::BeginTable("##ThreadsTable", 5, table_flags))
                 {
-                    lldb::SBThread th = process->GetThreadAtIndex(i);
-                    if (!th.IsValid())
+                    Defer(ImGui::EndTable());
+
+                    ImGui::TableSetupScrollFreeze(0, 1);
+                    ImGui::TableSetupColumn(
+                        "#", ImGuiTableColumnFlags_DefaultSort, 0.f,
+                        ImGuiID(ThreadSortColumn::IndexID)
+                    );
+                    ImGui::TableSetupColumn("TID", 0, 0.f, ImGuiID(ThreadSortColumn::ThreadID));
+                    ImGui::TableSetupColumn("NAME", 0, 0.f, ImGuiID(ThreadSortColumn::Name));
+                    ImGui::TableSetupColumn(
+                        "REASON", 0, 0.f, ImGuiID(ThreadSortColumn::StopReason)
+                    );
+                    ImGui::TableSetupColumn(
+                        "FUNCTION", 0, 0.f, ImGuiID(ThreadSortColumn::Function)
+                    );
+                    ImGui::TableHeadersRow();
+
+                    if (ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs();
+                        sort_specs != nullptr && sort_specs->SpecsDirty)
                     {
-                        LOG(Warning) << "Encountered invalid thread";
-                        continue;
+                        if (sort_specs->SpecsCount > 0)
+                        {
+                            const ImGuiTableColumnSortSpecs& spec = sort_specs->Specs[0];
+                            threads.set_sort(
+                                ThreadSortColumn(spec.ColumnUserID),
+                                spec.SortDirection == ImGuiSortDirection_Ascending
+                            );
+                        }
+                        sort_specs->SpecsDirty = false;
                     }
 
-                    const char* thread_name = th.GetName();
-                    if (thread_name == nullptr)
+                    // only the visible rows are formatted and submitted
+                    StringBuffer buf;
+                    ImGuiListClipper clipper;
+                    clipper.Begin(int(threads.view().size()));
+                    while (clipper.Step())
                     {
-                        LOG(Warning) << "Skipping thread with null name";
-                        // continue;
+                        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+                        {
+                            const ThreadInfo& info = threads.thread(threads.view()[size_t(row)]);
+
+                            ImGui::TableNextRow();
+                            ImGui::TableNextColumn();
+
+                            buf.format("{}##Thread_{}", info.index_id, info.id);
+                            if (ImGui::Selectable(
+                                    buf.data(), info.index_id == ui.viewed_thread_index_id,
+                                    ImGuiSelectableFlags_SpanAllColumns
+                                ))
+                            {
+                                ui.viewed_thread_index_id = info.index_id;
+                            }
+                            buf.clear();
+
+                            ImGui::TableNextColumn();
+                            buf.format("{}", info.id);
+                            ImGui::TextUnformatted(buf.data());
+                            buf.clear();
+
+                            ImGui::TableNextColumn();
+                            ImGui::TextUnformatted(info.name.c_str());
+
+                            ImGui::TableNextColumn();
+                            ImGui::TextUnformatted(info.stop_description.c_str());
+
+                            ImGui::TableNextColumn();
+                            ImGui::TextUnformatted(info.function_name.c_str());
+                        }
                     }
+                    clipper.End();
+                }
+            }
+        }
 
-                    thread_label.format("Thread {}", i);
+        if (ImGui::BeginTabItem("parallel stacks"))
+        {
+            Defer(ImGui::EndTabItem());
+            // the groups can't be checked against the stop without lldb
+            if (show_last_stop)
+            {
+                ImGui::TextDisabled("waiting for lldb...");
+            }
+            else if (process.has_value() && process_is_stopped(*process))
+            {
+                parallel_stacks.request(*process);
 
-                    if (ImGui::Selectable(thread_label.data(), i == ui.viewed_thread_index))
+                std::shared_ptr<const StackGroups> groups = parallel_stacks.groups();
+                if (parallel_stacks.is_collecting())
+                {
+                    ImGui::TextDisabled("unwinding threads...");
+                }
+                else if (groups != nullptr && groups->stop_id == process->GetStopID() &&
+                         groups->process_id == process->GetUniqueID())
+                {
+                    StringBuffer summary;
+                    summary.format(
+                        "{} threads, {} unique stacks ({} ms)", groups->threads.size(),
+                        groups->unique_stacks, groups->elapsed_ns / 1000000
+                    );
+                    ImGui::TextUnformatted(summary.data());
+                    ImGui::Separator();
+
+                    for (const uint32_t child : groups->nodes[StackGroups::ROOT].children)
                     {
-                        ui.viewed_thread_index = i;
+                        draw_stack_group(ui, *groups, child);
                     }
-                    // std::cout << "Thread: " << thread_label.data() << std::endl;
-
-                    thread_label.clear();
                 }
             }
         }
@@ -1004,8 +1462,8 @@ draw_threads(UserInterface& ui, std::optional<lldb::SBProcess> process, float st
 }
 
 static void draw_stack_trace(
-    UserInterface& ui, OpenFiles& open_files, std::optional<lldb::SBProcess> process,
-    float stack_height
+    UserInterface& ui, OpenFiles& open_files, StackTrace& stack_trace, SourceMap& source_map,
+    std::optional<lldb::SBProcess> process, bool show_last_stop, float stack_height
 )
 {
     ImGui::BeginChild("#StackTraceChild", ImVec2(0, stack_height));
@@ -1014,8 +1472,44 @@ static void draw_stack_trace(
     {
         if (ImGui::BeginTabItem("stack trace"))
         {
-            if (process.has_value() && process_is_stopped(*process))
+            const bool live = process.has_value() && process_is_stopped(*process);
+            if (live || show_last_stop)
             {
+                if (live)
+                {
+                    lldb::SBThread viewed_thread = find_viewed_thread(*process, ui);
+                    stack_trace.synchronize(*process, viewed_thread);
+                    stack_trace.ensure_loaded(
+                        std::max(StackTrace::PAGE_SIZE, ui.viewed_frame_index + 1), source_map
+                    );
+                }
+
+                if (stack_trace.complete() && stack_trace.loaded() > 0 &&
+                    ui.viewed_frame_index >= stack_trace.loaded())
+                {
+                    ui.viewed_frame_index = stack_trace.loaded() - 1;
+                }
+
+                StringBuffer buf;
+                if (stack_trace.complete())
+                {
+                    buf.format("{} frames", stack_trace.loaded());
+                    ImGui::TextUnformatted(buf.data());
+                }
+                else
+                {
+                    buf.format("at least {} frames", stack_trace.loaded());
+                    ImGui::TextUnformatted(buf.data());
+                    ImGui::SameLine();
+                    ImGui::BeginDisabled(!live);
+                    if (ImGui::SmallButton("unwind all"))
+                    {
+                        stack_trace.ensure_loaded(UINT32_MAX, source_map);
+                    }
+                    ImGui::EndDisabled();
+                }
+                buf.clear();
+
                 ImGui::Columns(3, "##StackTraceColumns");
                 ImGui::Separator();
                 ImGui::Text("FUNCTION");
@@ -1026,43 +1520,68 @@ static void draw_stack_trace(
                 ImGui::NextColumn();
                 ImGui::Separator();
 
-                lldb::SBThread viewed_thread = process->GetThreadAtIndex(ui.viewed_thread_index);
-                const uint32_t nframes = viewed_thread.GetNumFrames();
+                // one extra row stands in for the frames that haven't been unwound yet,
+                // once it scrolls into view the next page is loaded
+                const uint32_t nrows = stack_trace.loaded() + (stack_trace.complete() ? 0 : 1);
 
-                if (ui.viewed_frame_index >= nframes)
+                ImGuiListClipper clipper;
+                clipper.Begin(int(nrows));
+                while (clipper.Step())
                 {
-                    ui.viewed_frame_index = nframes - 1;
-                }
-
-                for (uint32_t i = 0; i < viewed_thread.GetNumFrames(); i++)
-                {
-                    auto frame = StackFrame::create(viewed_thread.GetFrameAtIndex(i));
-
-                    if (!frame)
+                    for (auto i = uint32_t(clipper.DisplayStart); i < uint32_t(clipper.DisplayEnd);
+                         i++)
                     {
-                        continue;
-                    }
+                        if (i >= stack_trace.loaded())
+                        {
+                            ImGui::TextDisabled("...");
+                            ImGui::NextColumn();
+                            ImGui::NextColumn();
+                            ImGui::NextColumn();
+                            if (live)
+                            {
+                                stack_trace.ensure_loaded(i + StackTrace::PAGE_SIZE, source_map);
+                            }
+                            continue;
+                        }
 
-                    if (ImGui::Selectable(
-                            frame->function_name.c_str(), i == ui.viewed_frame_index,
-                            ImGuiSelectableFlags_SpanAllColumns
-                        ))
-                    {
-                        const auto [_, linum] =
-                            get_stop_location_from_frame(viewed_thread.GetFrameAtIndex(i));
-                        manually_open_and_or_focus_file(ui, open_files, frame->file_handle, linum);
-                        ui.viewed_frame_index = i;
-                    }
-                    ImGui::NextColumn();
+                        const StackTraceFrame& frame = stack_trace.frame(i);
 
-                    ImGui::TextUnformatted(frame->file_handle.filename().c_str());
-                    ImGui::NextColumn();
+                        buf.format("{}##Frame_{}", frame.function_name, i);
+                        if (ImGui::Selectable(
+                                buf.data(), i == ui.viewed_frame_index,
+                                ImGuiSelectableFlags_SpanAllColumns
+                            ))
+                        {
+                            if (!frame.filepath.empty())
+                            {
+                                manually_open_and_or_focus_file(
+                                    ui, open_files, frame.filepath, frame.line
+                                );
+                            }
+                            ui.viewed_frame_index = i;
+                        }
+                        buf.clear();
+                        ImGui::NextColumn();
 
-                    StringBuffer linebuf;
-                    linebuf.format("{}", (int) frame->line);
-                    ImGui::TextUnformatted(linebuf.data());
-                    ImGui::NextColumn();
+                        if (!frame.filepath.empty())
+                        {
+                            ImGui::TextUnformatted(frame.filename.c_str());
+                            ImGui::NextColumn();
+
+                            buf.format("{}", frame.line);
+                            ImGui::TextUnformatted(buf.data());
+                            buf.clear();
+                        }
+                        else
+                        {
+                            ImGui::TextDisabled("??");
+                            ImGui::NextColumn();
+                        }
+                        ImGui::NextColumn();
+                    }
                 }
+                clipper.End();
+
                 ImGui::Columns(1);
             }
             ImGui::EndTabItem();
@@ -1073,56 +1592,122 @@ static void draw_stack_trace(
     ImGui::EndChild();
 }
 
-// TODO: add max depth?
-static void draw_local_recursive(lldb::SBValue local)
+static void
+draw_local_context_menu(lldb::SBValue& local, ArrayViewer& array_viewer, const char* popup_id)
 {
-    const char* local_type = local.GetDisplayTypeName();
-    const char* local_name = local.GetName();
-    const char* local_value = local.GetValue();
+    if (!ImGui::BeginPopupContextItem(popup_id))
+    {
+        return;
+    }
+    Defer(ImGui::EndPopup());
+
+    auto set_watchpoint = [&local](bool read, bool write)
+    {
+        lldb::SBError err;
+        lldb::SBWatchpoint watchpoint = local.Watch(true, read, write, err);
+        if (err.Fail() || !watchpoint.IsValid())
+        {
+            const char* err_cstr = err.GetCString();
+            LOG(Error) << "Failed to set watchpoint on " << local.GetName() << ": "
+                       << (err_cstr != nullptr ? err_cstr : "unknown error");
+        }
+        else
+        {
+            LOG(Info) << "Set watchpoint " << watchpoint.GetID() << " on " << local.GetName();
+        }
+    };
+
+    if (ImGui::MenuItem("watch writes"))
+    {
+        set_watchpoint(false, true);
+    }
+
+    if (ImGui::MenuItem("watch reads and writes"))
+    {
+        set_watchpoint(true, true);
+    }
+
+    ImGui::Separator();
 
-    if (local_type == nullptr || local_name == nullptr)
+    if (ImGui::MenuItem("visualize as array"))
+    {
+        array_viewer.open(local);
+    }
+}
+
+// TODO: add max depth?
+// Without 'live' nothing is asked of lldb: only the children fetched so far are
+// shown, and there is no context menu.
+static void draw_local_recursive(
+    LocalsTree& locals, uint32_t index, ArrayViewer& array_viewer, bool live,
+    bool ancestor_matched
+)
+{
+    // children of a match are shown unfiltered, so that matched structs can be explored
+    const bool filtering = locals.filter_active() && !ancestor_matched;
+    if (filtering && !locals.is_match(index) && !locals.has_matching_descendant(index))
     {
         return;
     }
 
+    // NOTE: 'local' is invalidated once children are fetched below
+    LocalNode& local = locals.node(index);
+
     StringBuffer children_node_label;
-    children_node_label.format("{}##Children_{}", local_name, local.GetID());
+    children_node_label.format("{}##Children_{}", local.name, local.id);
 
-    if (local.MightHaveChildren())
+    StringBuffer context_menu_label;
+    context_menu_label.format("##LocalContextMenu_{}", local.id);
+
+    if (local.might_have_children)
     {
-        if (ImGui::TreeNode(children_node_label.data()))
+        if (filtering && locals.has_matching_descendant(index))
+        {
+            ImGui::SetNextItemOpen(true);
+        }
+
+        const bool node_open = ImGui::TreeNode(children_node_label.data());
+        if (live)
+        {
+            draw_local_context_menu(local.value, array_viewer, context_menu_label.data());
+        }
+
+        ImGui::NextColumn();
+        ImGui::TextUnformatted(local.type.c_str());
+        ImGui::NextColumn();
+        ImGui::TextUnformatted("...");
+        ImGui::NextColumn();
+
+        if (node_open)
         {
-            ImGui::NextColumn();
-            ImGui::TextUnformatted(local_type);
-            ImGui::NextColumn();
-            ImGui::TextUnformatted("...");
-            ImGui::NextColumn();
+            const bool matched = ancestor_matched || locals.is_match(index);
 
             // TODO: figure out best way to handle very long children list
-            for (uint32_t i = 0; i < local.GetNumChildren(100); i++)
+            if (live)
+            {
+                locals.fetch_children(index, 100);
+            }
+            const std::vector<uint32_t> children = locals.node(index).children;
+            for (const uint32_t child : children)
             {
-                draw_local_recursive(local.GetChildAtIndex(i));
+                draw_local_recursive(locals, child, array_viewer, live, matched);
             }
             ImGui::TreePop();
         }
-        else
-        {
-            ImGui::NextColumn();
-            ImGui::TextUnformatted(local_type);
-            ImGui::NextColumn();
-            ImGui::TextUnformatted("...");
-            ImGui::NextColumn();
-        }
     }
     else
     {
-        ImGui::TextUnformatted(local_name);
+        ImGui::TextUnformatted(local.name.c_str());
+        if (live)
+        {
+            draw_local_context_menu(local.value, array_viewer, context_menu_label.data());
+        }
         ImGui::NextColumn();
-        ImGui::TextUnformatted(local_type);
+        ImGui::TextUnformatted(local.type.c_str());
         ImGui::NextColumn();
-        if (local_value != nullptr)
+        if (!local.value_text.empty())
         {
-            ImGui::TextUnformatted(local_value);
+            ImGui::TextUnformatted(local.value_text.c_str());
         }
         else
         {
@@ -1132,8 +1717,104 @@ static void draw_local_recursive(lldb::SBValue local)
     }
 }
 
+static void draw_watch_expressions(ExpressionEvaluator& expressions, bool can_evaluate)
+{
+    static std::array<char, 512> expression_buf = {};
+    if (ImGui::InputTextWithHint(
+            "##NewWatchExpression", "add watch expression", expression_buf.data(),
+            expression_buf.size(), ImGuiInputTextFlags_EnterReturnsTrue
+        ))
+    {
+        expressions.add_expression(std::string(expression_buf.data()));
+        expression_buf.fill(0);
+    }
+
+    ImGui::SameLine();
+    int timeout_ms = int(expressions.timeout_us() / 1000);
+    ImGui::SetNextItemWidth(ImGui::CalcTextSize("000000").x);
+    if (ImGui::DragInt("timeout (ms)", &timeout_ms, 10.f, 1, 60000))
+    {
+        expressions.set_timeout_us(uint32_t(timeout_ms) * 1000);
+    }
+
+    if (expressions.is_busy())
+    {
+        if (ImGui::Button("cancel"))
+        {
+            expressions.cancel();
+        }
+        ImGui::SameLine();
+        const std::string running = expressions.running_expression();
+        ImGui::Text("evaluating: %s", running.c_str());
+    }
+    else if (ImGui::Button("re-evaluate"))
+    {
+        expressions.reevaluate();
+    }
+
+    ImGui::Columns(3, "##WatchColumns");
+    ImGui::Separator();
+    ImGui::Text("EXPRESSION");
+    ImGui::NextColumn();
+    ImGui::Text("VALUE");
+    ImGui::NextColumn();
+    ImGui::Text("TYPE");
+    ImGui::NextColumn();
+    ImGui::Separator();
+    Defer(ImGui::Columns(1));
+
+    std::optional<size_t> expression_to_remove = {};
+
+    StringBuffer remove_label;
+    for (size_t i = 0; i < expressions.expressions().size(); i++)
+    {
+        const std::string& expression = expressions.expressions()[i];
+        const ExpressionResult result = expressions.result(expression, can_evaluate);
+
+        remove_label.format("x##RemoveWatch_{}", i);
+        if (ImGui::SmallButton(remove_label.data()))
+        {
+            expression_to_remove = i;
+        }
+        remove_label.clear();
+        ImGui::SameLine();
+        ImGui::TextUnformatted(expression.c_str());
+        ImGui::NextColumn();
+
+        switch (result.status)
+        {
+        case ExpressionResult::Status::Pending:
+            ImGui::TextDisabled("...");
+            break;
+        case ExpressionResult::Status::Completed:
+            ImGui::TextUnformatted(result.value.c_str());
+            break;
+        case ExpressionResult::Status::Failed:
+            ImGui::TextColored(
+                ImVec4(212.f / 255.f, 67.f / 255.f, 67.f / 255.f, 255.f / 255.f), "%s",
+                result.error.c_str()
+            );
+            break;
+        case ExpressionResult::Status::Cancelled:
+            ImGui::TextDisabled("cancelled");
+            break;
+        }
+        ImGui::NextColumn();
+
+        ImGui::TextUnformatted(result.type.c_str());
+        ImGui::NextColumn();
+    }
+
+    if (expression_to_remove.has_value())
+    {
+        expressions.remove_expression(*expression_to_remove);
+    }
+}
+
 static void draw_locals_and_registers(
-    UserInterface& ui, std::optional<lldb::SBProcess> process, float stack_height
+    UserInterface& ui, LocalsTree& locals, ExpressionEvaluator& expressions,
+    ArrayViewer& array_viewer, std::optional<lldb::SBProcess> process, bool show_last_stop,
+    float stack_height
 )
 {
     ImGui::BeginChild("#LocalsChild", ImVec2(0, stack_height));
@@ -1142,8 +1823,29 @@ static void draw_locals_and_registers(
     {
         if (ImGui::BeginTabItem("locals"))
         {
-            if (process.has_value() && process_is_stopped(*process))
+            const bool live = process.has_value() && process_is_stopped(*process);
+            if (live || show_last_stop)
             {
+                if (live)
+                {
+                    lldb::SBThread viewed_thread = find_viewed_thread(*process, ui);
+                    locals.synchronize(*process, viewed_thread, ui.viewed_frame_index);
+                }
+
+                static std::array<char, 256> filter_buf = {};
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x / 2);
+                ImGui::InputTextWithHint(
+                    "##LocalsFilter", "filter by name, type or value", filter_buf.data(),
+                    filter_buf.size()
+                );
+                locals.set_filter(filter_buf.data());
+
+                if (locals.filter_active())
+                {
+                    ImGui::SameLine();
+                    ImGui::Text("%zu matches", locals.match_count());
+                }
+
                 ImGui::Columns(3, "##LocalsColumns");
                 ImGui::Separator();
                 ImGui::Text("NAME");
@@ -1154,14 +1856,10 @@ static void draw_locals_and_registers(
                 ImGui::NextColumn();
                 ImGui::Separator();
 
-                lldb::SBThread viewed_thread = process->GetThreadAtIndex(ui.viewed_thread_index);
-                lldb::SBFrame frame = viewed_thread.GetFrameAtIndex(ui.viewed_frame_index);
-                lldb::SBValueList locals = frame.GetVariables(true, true, true, true);
-
                 // TODO: select entire row like in stack trace
-                for (uint32_t i = 0; i < locals.GetSize(); i++)
+                for (const uint32_t root : locals.roots())
                 {
-                    draw_local_recursive(locals.GetValueAtIndex(i));
+                    draw_local_recursive(locals, root, array_viewer, live, false);
                 }
 
                 ImGui::Columns(1);
@@ -1169,11 +1867,29 @@ static void draw_locals_and_registers(
             ImGui::EndTabItem();
         }
 
+        if (ImGui::BeginTabItem("watch"))
+        {
+            // NOTE: while an expression is being evaluated 'process' is empty, and
+            // only cached results are shown
+            const bool process_stopped = process.has_value() && process_is_stopped(*process);
+            if (process_stopped)
+            {
+                lldb::SBThread viewed_thread = find_viewed_thread(*process, ui);
+                expressions.set_context(*process, viewed_thread, ui.viewed_frame_index);
+            }
+            draw_watch_expressions(expressions, process_stopped || expressions.is_busy());
+            ImGui::EndTabItem();
+        }
+
         if (ImGui::BeginTabItem("registers"))
         {
-            if (process.has_value() && process_is_stopped(*process))
+            if (show_last_stop)
+            {
+                ImGui::TextDisabled("waiting for lldb...");
+            }
+            else if (process.has_value() && process_is_stopped(*process))
             {
-                lldb::SBThread viewed_thread = process->GetThreadAtIndex(ui.viewed_thread_index);
+                lldb::SBThread viewed_thread = find_viewed_thread(*process, ui);
                 lldb::SBFrame frame = viewed_thread.GetFrameAtIndex(ui.viewed_frame_index);
                 if (viewed_thread.IsValid() && frame.IsValid())
                 {
@@ -1218,15 +1934,222 @@ static void draw_locals_and_registers(
             ImGui::EndTabItem();
         }
 
-        ImGui::EndTabBar();
-        // ImGui::SameLine(ImGui::GetWindowWidth() - 150);
-        // ImGui::Checkbox("use hexadecimal", &use_hex_locals);
+        ImGui::EndTabBar();
+        // ImGui::SameLine(ImGui::GetWindowWidth() - 150);
+        // ImGui::Checkbox("use hexadecimal", &use_hex_locals);
+    }
+    ImGui::EndChild();
+}
+
+static void draw_watchpoints(WatchpointList& watchpoints, std::optional<lldb::SBTarget> target)
+{
+    if (!target.has_value())
+    {
+        return;
+    }
+
+    watchpoints.synchronize(*target);
+
+    StringBuffer slots_label;
+    if (auto nslots = watchpoints.supported_hardware_slots(); nslots.has_value())
+    {
+        slots_label.format(
+            "hardware slots used: {} / {}", watchpoints.used_hardware_slots(), *nslots
+        );
+    }
+    else
+    {
+        slots_label.format("hardware slots used: {}", watchpoints.used_hardware_slots());
+    }
+    ImGui::TextUnformatted(slots_label.data());
+
+    ImGui::Columns(5, "##WatchpointColumns");
+    ImGui::Separator();
+    ImGui::Text("ID");
+    ImGui::NextColumn();
+    ImGui::Text("ADDRESS");
+    ImGui::NextColumn();
+    ImGui::Text("SIZE");
+    ImGui::NextColumn();
+    ImGui::Text("HITS");
+    ImGui::NextColumn();
+    ImGui::Text("SLOT");
+    ImGui::NextColumn();
+    ImGui::Separator();
+    Defer(ImGui::Columns(1));
+
+    // deferred until after the loop, since modifying watchpoints invalidates the list
+    std::optional<lldb::watch_id_t> watchpoint_to_delete = {};
+    std::optional<std::pair<lldb::watch_id_t, bool>> watchpoint_to_enable = {};
+
+    StringBuffer buf;
+    for (const WatchpointInfo& info : watchpoints.watchpoints())
+    {
+        buf.format("{}##Watchpoint_{}", info.id, info.id);
+        if (!info.enabled)
+        {
+            ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetStyle().Colors[ImGuiCol_TextDisabled]);
+        }
+        ImGui::Selectable(buf.data(), false, ImGuiSelectableFlags_SpanAllColumns);
+        if (!info.enabled)
+        {
+            ImGui::PopStyleColor();
+        }
+        buf.clear();
+
+        if (ImGui::BeginPopupContextItem())
+        {
+            if (ImGui::MenuItem(info.enabled ? "disable" : "enable"))
+            {
+                watchpoint_to_enable = std::make_pair(info.id, !info.enabled);
+            }
+            if (ImGui::MenuItem("delete"))
+            {
+                watchpoint_to_delete = info.id;
+            }
+            ImGui::EndPopup();
+        }
+
+        if (ImGui::IsItemHovered() && !info.condition.empty())
+        {
+            ImGui::SetTooltip("condition: %s", info.condition.c_str());
+        }
+        ImGui::NextColumn();
+
+        buf.format("0x{:x}", info.address);
+        ImGui::TextUnformatted(buf.data());
+        buf.clear();
+        ImGui::NextColumn();
+
+        buf.format("{}", info.size);
+        ImGui::TextUnformatted(buf.data());
+        buf.clear();
+        ImGui::NextColumn();
+
+        if (info.ignore_count > 0)
+        {
+            buf.format("{} (ignore {})", info.hit_count, info.ignore_count);
+        }
+        else
+        {
+            buf.format("{}", info.hit_count);
+        }
+        ImGui::TextUnformatted(buf.data());
+        buf.clear();
+        ImGui::NextColumn();
+
+        if (info.hardware_index >= 0)
+        {
+            buf.format("{}", info.hardware_index);
+        }
+        else
+        {
+            buf.format("-");
+        }
+        ImGui::TextUnformatted(buf.data());
+        buf.clear();
+        ImGui::NextColumn();
+    }
+
+    if (watchpoint_to_enable.has_value())
+    {
+        lldb::SBWatchpoint watchpoint = target->FindWatchpointByID(watchpoint_to_enable->first);
+        watchpoint.SetEnabled(watchpoint_to_enable->second);
+        watchpoints.invalidate();
+    }
+
+    if (watchpoint_to_delete.has_value())
+    {
+        if (!target->DeleteWatchpoint(*watchpoint_to_delete))
+        {
+            LOG(Error) << "Failed to delete watchpoint: " << *watchpoint_to_delete;
+        }
+        watchpoints.invalidate();
+    }
+}
+
+static void draw_tracepoints(
+    OpenFiles& open_files, Tracepoints& tracepoints, std::optional<lldb::SBTarget> target
+)
+{
+    static std::array<char, 1024> file_buf = {};
+    static int line = 1;
+    static std::array<char, 512> expressions_buf = {};
+
+    if (file_buf[0] == '\0')
+    {
+        if (std::optional<FileHandle> focus = open_files.focus(); focus.has_value())
+        {
+            const std::string path = to_utf8(focus->filepath());
+            path.copy(file_buf.data(), std::min(path.size(), file_buf.size() - 1));
+        }
+    }
+
+    ImGui::InputText("file", file_buf.data(), file_buf.size());
+    ImGui::InputInt("line", &line);
+    ImGui::InputTextWithHint(
+        "values", "comma separated, e.g. i, node->next, v[3]", expressions_buf.data(),
+        expressions_buf.size()
+    );
+
+    if (!target.has_value())
+    {
+        ImGui::TextUnformatted("Tracepoints can't be changed while lldb is busy.");
+        return;
+    }
+
+    if (ImGui::Button("add tracepoint") && file_buf[0] != '\0' && line > 0)
+    {
+        std::vector<std::string> expressions;
+        std::string_view rest(expressions_buf.data());
+        while (!rest.empty())
+        {
+            const size_t comma = std::min(rest.find(','), rest.size());
+            std::string_view expression = rest.substr(0, comma);
+            rest.remove_prefix(std::min(comma + 1, rest.size()));
+
+            const size_t first = std::min(expression.find_first_not_of(' '), expression.size());
+            expression.remove_prefix(first);
+            expression = expression.substr(0, expression.find_last_not_of(' ') + 1);
+            if (!expression.empty())
+            {
+                expressions.emplace_back(expression);
+            }
+        }
+        tracepoints.add(*target, file_buf.data(), uint32_t(line), std::move(expressions));
+    }
+
+    tracepoints.synchronize(*target);
+
+    ImGui::Separator();
+    StringBuffer label;
+    for (const std::unique_ptr<Tracepoint>& tracepoint : tracepoints.tracepoints())
+    {
+        if (tracepoint->removed)
+        {
+            continue;
+        }
+
+        ImGui::PushID(int(tracepoint->index));
+        if (ImGui::SmallButton("x"))
+        {
+            tracepoints.remove(*target, tracepoint->index);
+        }
+        ImGui::PopID();
+        ImGui::SameLine();
+
+        label.clear();
+        label.format(
+            "{}  {} hits, {:.0f}/s", tracepoint->location,
+            tracepoint->hits.load(std::memory_order_relaxed), tracepoint->hits_per_second
+        );
+        ImGui::TextUnformatted(label.data());
     }
-    ImGui::EndChild();
 }
 
 static void draw_breakpoints_and_watchpoints(
-    UserInterface& ui, OpenFiles& open_files, std::optional<lldb::SBTarget> target,
+    UserInterface& ui, OpenFiles& open_files, WatchpointList& watchpoints,
+    Tracepoints& tracepoints, SourceMap& source_map, std::optional<lldb::SBTarget> target,
     float stack_height
 )
 {
@@ -1308,8 +2231,11 @@ static void draw_breakpoints_and_watchpoints(
                             ImGuiSelectableFlags_SpanAllColumns
                         ))
                     {
-                        fs::path breakpoint_filepath = fs::path(directory) / fs::path(filename);
-                        manually_open_and_or_focus_file(ui, open_files, breakpoint_filepath);
+                        if (auto breakpoint_filepath = source_map.resolve(directory, filename);
+                            breakpoint_filepath.has_value())
+                        {
+                            manually_open_and_or_focus_file(ui, open_files, *breakpoint_filepath);
+                        }
                         ui.viewed_breakpoint_index = i;
                     }
                     ImGui::NextColumn();
@@ -1325,17 +2251,13 @@ static void draw_breakpoints_and_watchpoints(
         if (ImGui::BeginTabItem("watchpoints"))
         {
             Defer(ImGui::EndTabItem());
+            draw_watchpoints(watchpoints, target);
+        }
 
-            // TODO: add actual watch points
-            for (int i = 0; i < 4; i++)
-            {
-                StringBuffer label;
-                label.format("Watch {}", i);
-                if (ImGui::Selectable(label.data(), i == 0))
-                {
-                    // blah
-                }
-            }
+        if (ImGui::BeginTabItem("tracepoints"))
+        {
+            Defer(ImGui::EndTabItem());
+            draw_tracepoints(open_files, tracepoints, target);
         }
     }
     ImGui::EndChild();
@@ -1367,6 +2289,270 @@ static void draw_debug_stream_popup(UserInterface& ui)
 }
 #endif
 
+static void draw_symbol_search(Application& app, std::optional<lldb::SBTarget> target)
+{
+    static constexpr const char* popup_id = "Go to symbol";
+    static constexpr size_t max_results = 200;
+
+    if (ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_T, false))
+    {
+        ImGui::OpenPopup(popup_id);
+    }
+
+    const ImVec2 popup_size(
+        std::min(900.f, 0.6f * float(app.ui.window_width)), 0.5f * float(app.ui.window_height)
+    );
+    ImGui::SetNextWindowSize(popup_size, ImGuiCond_Appearing);
+    if (!ImGui::BeginPopupModal(popup_id, nullptr, ImGuiWindowFlags_NoSavedSettings))
+    {
+        return;
+    }
+    Defer(ImGui::EndPopup());
+
+    if (target.has_value() && target->IsValid())
+    {
+        app.symbols.request(*target);
+    }
+
+    static std::array<char, 256> query_buf = {};
+    static std::string last_query;
+    static std::weak_ptr<const SymbolTable> last_table; // weak, must not outlive lldb
+    static std::vector<SymbolMatch> matches;
+    static size_t selected = 0;
+
+    if (ImGui::IsWindowAppearing())
+    {
+        ImGui::SetKeyboardFocusHere();
+    }
+    ImGui::SetNextItemWidth(-1.f);
+    const bool accepted = ImGui::InputTextWithHint(
+        "##SymbolQuery", "function or variable name", query_buf.data(), query_buf.size(),
+        ImGuiInputTextFlags_EnterReturnsTrue
+    );
+
+    // only re-run the query when its text or the index changes
+    std::shared_ptr<const SymbolTable> table = app.symbols.table();
+    if (table != nullptr && (table != last_table.lock() || last_query != query_buf.data()))
+    {
+        last_table = table;
+        last_query = query_buf.data();
+        matches = app.symbols.query(*table, last_query, max_results);
+        selected = 0;
+    }
+
+    StringBuffer buf;
+    if (app.symbols.is_indexing())
+    {
+        const auto [done, total] = app.symbols.progress();
+        buf.format("indexing symbols ({}/{} modules)...", done, total);
+        ImGui::TextDisabled("%s", buf.data());
+        buf.clear();
+    }
+    else if (table != nullptr)
+    {
+        buf.format("{} symbols", table->symbols.size());
+        ImGui::TextDisabled("%s", buf.data());
+        buf.clear();
+    }
+    else
+    {
+        ImGui::TextDisabled("no target");
+    }
+
+    if (ImGui::IsKeyPressed(ImGuiKey_DownArrow) && selected + 1 < matches.size())
+    {
+        selected++;
+    }
+    if (ImGui::IsKeyPressed(ImGuiKey_UpArrow) && selected > 0)
+    {
+        selected--;
+    }
+
+    std::optional<size_t> picked = {};
+    if (accepted && selected < matches.size())
+    {
+        picked = selected;
+    }
+
+    ImGui::BeginChild("##SymbolResults", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()));
+    if (table != nullptr)
+    {
+        ImGuiListClipper clipper;
+        clipper.Begin(int(matches.size()));
+        while (clipper.Step())
+        {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+            {
+                const SymbolRecord& symbol = table->symbols[matches[size_t(i)].index];
+                const std::string_view name = table->name(symbol);
+
+                buf.format(
+                    "{}{}##Symbol_{}", symbol.kind == SymbolKind::Data ? "[data] " : "", name, i
+                );
+                if (ImGui::Selectable(buf.data(), size_t(i) == selected))
+                {
+                    picked = size_t(i);
+                }
+                buf.clear();
+
+                if (size_t(i) == selected && ImGui::IsKeyPressed(ImGuiKey_DownArrow))
+                {
+                    ImGui::SetScrollHereY(1.f);
+                }
+                else if (size_t(i) == selected && ImGui::IsKeyPressed(ImGuiKey_UpArrow))
+                {
+                    ImGui::SetScrollHereY(0.f);
+                }
+            }
+        }
+        clipper.End();
+    }
+    ImGui::EndChild();
+
+    // 'target' is empty while lldb is busy, and resolving the location needs lldb
+    if (picked.has_value() && table != nullptr && target.has_value())
+    {
+        const SymbolRecord& symbol = table->symbols[matches[*picked].index];
+        if (auto location = SymbolIndex::resolve_location(*table, symbol);
+            location.has_value())
+        {
+            const auto& [recorded_filepath, linum] = *location;
+            if (auto filepath = app.source_map.resolve(recorded_filepath); filepath.has_value())
+            {
+                manually_open_and_or_focus_file(app.ui, app.open_files, *filepath, linum);
+            }
+        }
+        else
+        {
+            LOG(Warning) << "No source location for symbol: " << table->name(symbol);
+        }
+        ImGui::CloseCurrentPopup();
+    }
+
+    if (ImGui::Button("close") || ImGui::IsKeyPressed(ImGuiKey_Escape))
+    {
+        ImGui::CloseCurrentPopup();
+    }
+}
+
+static void draw_file_finder(Application& app, std::optional<lldb::SBTarget> target)
+{
+    static constexpr const char* popup_id = "Go to file";
+    static constexpr size_t max_results = 200;
+
+    if (ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_P, false))
+    {
+        ImGui::OpenPopup(popup_id);
+    }
+
+    const ImVec2 popup_size(
+        std::min(900.f, 0.6f * float(app.ui.window_width)), 0.5f * float(app.ui.window_height)
+    );
+    ImGui::SetNextWindowSize(popup_size, ImGuiCond_Appearing);
+    if (!ImGui::BeginPopupModal(popup_id, nullptr, ImGuiWindowFlags_NoSavedSettings))
+    {
+        return;
+    }
+    Defer(ImGui::EndPopup());
+
+    static std::array<char, 256> query_buf = {};
+    static std::string last_query;
+    static std::weak_ptr<const FileIndex> last_index;
+    static std::vector<FuzzyMatchResult> matches;
+    static size_t selected = 0;
+
+    if (ImGui::IsWindowAppearing())
+    {
+        // incremental, so re-crawling every time the finder is opened is cheap
+        app.file_finder.refresh(
+            fs::path(app.file_browser->filepath()), target.value_or(lldb::SBTarget())
+        );
+        ImGui::SetKeyboardFocusHere();
+    }
+    ImGui::SetNextItemWidth(-1.f);
+    const bool accepted = ImGui::InputTextWithHint(
+        "##FileQuery", "file name or path", query_buf.data(), query_buf.size(),
+        ImGuiInputTextFlags_EnterReturnsTrue
+    );
+
+    // only re-run the query when its text or the index changes
+    std::shared_ptr<const FileIndex> index = app.file_finder.index();
+    if (index != nullptr && (index != last_index.lock() || last_query != query_buf.data()))
+    {
+        last_index = index;
+        last_query = query_buf.data();
+        matches = app.file_finder.query(*index, last_query, max_results);
+        selected = std::min(selected, matches.empty() ? 0 : matches.size() - 1);
+    }
+
+    StringBuffer buf;
+    buf.format(
+        "{} files{}", index != nullptr ? index->size : 0,
+        app.file_finder.is_crawling() ? ", crawling..." : ""
+    );
+    ImGui::TextDisabled("%s", buf.data());
+    buf.clear();
+
+    if (ImGui::IsKeyPressed(ImGuiKey_DownArrow) && selected + 1 < matches.size())
+    {
+        selected++;
+    }
+    if (ImGui::IsKeyPressed(ImGuiKey_UpArrow) && selected > 0)
+    {
+        selected--;
+    }
+
+    std::optional<size_t> picked = {};
+    if (accepted && selected < matches.size())
+    {
+        picked = selected;
+    }
+
+    ImGui::BeginChild("##FileResults", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()));
+    if (index != nullptr)
+    {
+        ImGuiListClipper clipper;
+        clipper.Begin(int(matches.size()));
+        while (clipper.Step())
+        {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+            {
+                const FileEntry& entry = index->file(matches[size_t(i)].index);
+
+                buf.format("{}##File_{}", entry.display(), i);
+                if (ImGui::Selectable(buf.data(), size_t(i) == selected))
+                {
+                    picked = size_t(i);
+                }
+                buf.clear();
+
+                if (size_t(i) == selected && ImGui::IsKeyPressed(ImGuiKey_DownArrow))
+                {
+                    ImGui::SetScrollHereY(1.f);
+                }
+                else if (size_t(i) == selected && ImGui::IsKeyPressed(ImGuiKey_UpArrow))
+                {
+                    ImGui::SetScrollHereY(0.f);
+                }
+            }
+        }
+        clipper.End();
+    }
+    ImGui::EndChild();
+
+    if (picked.has_value() && index != nullptr)
+    {
+        const FileEntry& entry = index->file(matches[*picked].index);
+        manually_open_and_or_focus_file(app.ui, app.open_files, fs::path(entry.path));
+        ImGui::CloseCurrentPopup();
+    }
+
+    if (ImGui::Button("close") || ImGui::IsKeyPressed(ImGuiKey_Escape))
+    {
+        ImGui::CloseCurrentPopup();
+    }
+}
+
 __attribute__((flatten)) static void draw(Application& app)
 {
 
@@ -1385,6 +2571,23 @@ __attribute__((flatten)) static void draw(Application& app)
     ImGui::Begin("lldbg", nullptr, main_window_flags);
     ImGui::PushFont(ui.font);
 
+    // The panels below are drawn without a target/process while lldb is busy.
+    // If the process was stopped before, they keep showing what they read at
+    // that stop meanwhile (not while sampling, the process runs then).
+    const bool lldb_busy = lldb_is_busy(app);
+    auto process = lldb_busy ? std::nullopt : find_process(app.debugger);
+    auto target = lldb_busy ? std::nullopt : find_target(app.debugger);
+
+    static bool process_was_stopped = false;
+    if (!lldb_busy)
+    {
+        process_was_stopped = process.has_value() && process_is_stopped(*process);
+    }
+    const bool show_last_stop = lldb_busy && process_was_stopped && !app.sampler.is_active();
+
+    Logger::get_instance()->drain();
+    app.tracepoints.update();
+
     {
         Splitter(
             "##S1", true, 3.0f, &ui.file_browser_width, &ui.file_viewer_width,
@@ -1394,7 +2597,31 @@ __attribute__((flatten)) static void draw(Application& app)
 
         ImGui::BeginGroup();
         ImGui::BeginChild("ControlBarAndFileBrowser", ImVec2(ui.file_browser_width, 0));
-        draw_control_bar(app.debugger, app.cmdline, app.listener, app.ui);
+        if (app.sampler.is_active())
+        {
+            ImGui::TextUnformatted(app.sampler.is_sampling() ? "Sampling..." : "Finishing...");
+            draw_sampler_status(app.sampler);
+            ImGui::BeginDisabled(!app.sampler.is_sampling());
+            if (ImGui::Button("stop sampling"))
+            {
+                app.sampler.request_stop();
+            }
+            ImGui::EndDisabled();
+        }
+        else if (app.cmdline.is_running())
+        {
+            ImGui::TextUnformatted("Waiting for console command...");
+        }
+        else if (lldb_busy)
+        {
+            ImGui::TextUnformatted("Waiting for expression evaluation...");
+        }
+        else
+        {
+            draw_control_bar(
+                app.debugger, app.cmdline, app.listener, app.ui, app.sampler, app.flame_graph
+            );
+        }
         ImGui::Separator();
         draw_file_browser(app, app.file_browser.get(), 0);
         ImGui::EndChild();
@@ -1434,10 +2661,17 @@ __attribute__((flatten)) static void draw(Application& app)
 
         // TODO: let locals tab have all the expanded space
 
-        draw_threads(ui, find_process(app.debugger), stack_height);
-        draw_stack_trace(ui, open_files, find_process(app.debugger), stack_height);
-        draw_locals_and_registers(ui, find_process(app.debugger), stack_height);
-        draw_breakpoints_and_watchpoints(ui, open_files, find_target(app.debugger), stack_height);
+        draw_threads(ui, app.threads, app.parallel_stacks, process, show_last_stop, stack_height);
+        draw_stack_trace(
+            ui, open_files, app.stack_trace, app.source_map, process, show_last_stop, stack_height
+        );
+        draw_locals_and_registers(
+            ui, app.locals, app.expressions, app.array_viewer, process, show_last_stop,
+            stack_height
+        );
+        draw_breakpoints_and_watchpoints(
+            ui, open_files, app.watchpoints, app.tracepoints, app.source_map, target, stack_height
+        );
 
         ImGui::EndGroup();
     }
@@ -1457,106 +2691,257 @@ __attribute__((flatten)) static void draw(Application& app)
     ImGui::PopFont();
     ImGui::End();
 
+    ImGui::PushFont(ui.font);
+    app.array_viewer.render(process);
+    app.flame_graph.render(target, app.sampler);
+    draw_symbol_search(app, target);
+    draw_file_finder(app, target);
+    ImGui::PopFont();
+
 #ifdef DEBUG
     draw_debug_stream_popup(ui);
 #endif
 }
 
+struct StoppedThread
+{
+    lldb::SBThread thread;
+    lldb::StopReason stop_reason;
+};
+
+struct StopSummary
+{
+    std::optional<StoppedThread> primary; // the thread the UI focuses
+    std::vector<std::pair<uint32_t, lldb::StopReason>> stopped; // index ids of all with a reason
+};
+
+static bool has_stop_reason(lldb::StopReason reason)
+{
+    return reason != lldb::eStopReasonNone && reason != lldb::eStopReasonInvalid;
+}
+
+// lldb selects the thread that caused the stop, so that one is taken as is;
+// only if it has no stop reason is the first thread that does used instead.
+// All threads with a stop reason are collected in a single pass, reading just
+// the stop reason of each thread.
+static StopSummary summarize_stop(lldb::SBProcess& process)
+{
+    StopSummary summary;
+
+    if (lldb::SBThread selected = process.GetSelectedThread(); selected.IsValid())
+    {
+        if (const lldb::StopReason reason = selected.GetStopReason(); has_stop_reason(reason))
+        {
+            summary.primary = StoppedThread{selected, reason};
+        }
+    }
+
+    const uint32_t nthreads = process.GetNumThreads();
+    for (uint32_t i = 0; i < nthreads; i++)
+    {
+        lldb::SBThread th = process.GetThreadAtIndex(i);
+        const lldb::StopReason reason = th.GetStopReason();
+        if (!has_stop_reason(reason))
+        {
+            continue;
+        }
+
+        summary.stopped.emplace_back(th.GetIndexID(), reason);
+        if (!summary.primary.has_value())
+        {
+            summary.primary = StoppedThread{th, reason};
+        }
+    }
+
+    return summary;
+}
+
+static void log_stop_summary(const StopSummary& summary)
+{
+    static constexpr size_t MAX_LISTED_THREADS = 8;
+
+    if (summary.stopped.size() < 2)
+    {
+        return;
+    }
+
+    std::string threads;
+    for (size_t i = 0; i < std::min(summary.stopped.size(), MAX_LISTED_THREADS); i++)
+    {
+        const auto& [index_id, reason] = summary.stopped[i];
+        threads += fmt::format(
+            "{}thread #{} ({})", i > 0 ? ", " : "", index_id, stop_reason_to_string(reason)
+        );
+    }
+    if (summary.stopped.size() > MAX_LISTED_THREADS)
+    {
+        threads += ", ...";
+    }
+
+    LOG_CAT(Info, LldbEvent) << summary.stopped.size() << " threads stopped: " << threads;
+}
+
 static void handle_lldb_events(
     lldb::SBDebugger& debugger, lldb::SBListener& listener, UserInterface& ui,
-    OpenFiles& open_files, FileViewer& file_viewer
+    OpenFiles& open_files, FileViewer& file_viewer, WatchpointList& watchpoints,
+    SourceMap& source_map, DisassemblyCache& disassembly, Sampler& sampler, FlameGraph& flame_graph
 )
 {
     lldb::SBEvent event;
 
+    // the sampling thread may finish at any time, only events queued before
+    // it did are sure to be covered by this
+    const bool sampling_finished = sampler.is_active() && !sampler.is_sampling();
+
     while (true)
     {
         const bool event_found = listener.GetNextEvent(event);
         if (!event_found)
         {
-            break;
+            // once the sampler's own stops and resumes have all been drained,
+            // catch up on the process having stopped by itself, if it did
+            if (!sampling_finished || !sampler.is_active())
+            {
+                break;
+            }
+
+            event = sampler.finish();
+            if (!event.IsValid())
+            {
+                break;
+            }
         }
 
         if (!event.IsValid())
         {
-            LOG(Warning) << "Invalid event found.";
+            LOG_CAT(Warning, LldbEvent) << "Invalid event found.";
             continue;
         }
 
-        lldb::SBStream event_description;
-        event.GetDescription(event_description);
-        LOG(Verbose) << "Event Description => " << event_description.GetData();
+        if (log_enabled(LogLevel::Verbose))
+        {
+            lldb::SBStream event_description;
+            event.GetDescription(event_description);
+            LOG_CAT(Verbose, LldbEvent) << "Event Description => " << event_description.GetData();
+        }
 
         auto target = find_target(debugger);
         auto process = find_process(debugger);
 
         if (target.has_value() && event.BroadcasterMatchesRef(target->GetBroadcaster()))
         {
-            LOG(Debug) << "Found target event";
-            file_viewer.synchronize_breakpoint_cache(*target);
+            LOG_CAT(Debug, LldbEvent) << "Found target event";
+
+            constexpr uint32_t module_event_mask = lldb::SBTarget::eBroadcastBitModulesLoaded |
+                                                   lldb::SBTarget::eBroadcastBitModulesUnloaded |
+                                                   lldb::SBTarget::eBroadcastBitSymbolsLoaded;
+            if ((event.GetType() & module_event_mask) != 0)
+            {
+                // code may now be mapped at (or symbolicated for) addresses that
+                // were disassembled or failed to before
+                disassembly.clear();
+            }
+            else if (lldb::SBWatchpoint::EventIsWatchpointEvent(event))
+            {
+                watchpoints.invalidate();
+            }
+            else
+            {
+                file_viewer.synchronize_breakpoint_cache(*target, source_map);
+            }
         }
         else if (process.has_value() && event.BroadcasterMatchesRef(process->GetBroadcaster()))
         {
+            // the sampler stops and resumes the process many times a second
+            if (sampler.is_active() &&
+                (event.GetType() & lldb::SBProcess::eBroadcastBitStateChanged) != 0)
+            {
+                sampler.defer_event(event);
+                continue;
+            }
+
             const lldb::StateType new_state = lldb::SBProcess::GetStateFromEvent(event);
             const char* state_descr = lldb::SBDebugger::StateAsCString(new_state);
 
             if (state_descr != nullptr)
             {
-                LOG(Debug) << "Found process event with new state: " << state_descr;
+                LOG_CAT(Debug, LldbEvent) << "Found process event with new state: " << state_descr;
             }
 
-            // For now we find the first (if any) stopped thread and construct a
-            // StopInfo.
             if (new_state == lldb::eStateStopped)
             {
-                const uint32_t nthreads = process->GetNumThreads();
-                for (uint32_t i = 0; i < nthreads; i++)
+                // hit counts may have changed without a watchpoint event
+                watchpoints.invalidate();
+
+                // the threads panel takes its own snapshot of all threads when drawn
+                const StopSummary summary = summarize_stop(*process);
+                log_stop_summary(summary);
+
+                const std::optional<StoppedThread>& stopped = summary.primary;
+                if (!stopped.has_value())
                 {
-                    lldb::SBThread th = process->GetThreadAtIndex(i);
-                    switch (th.GetStopReason())
+                    LOG_CAT(Warning, LldbEvent) << "Unable to resolve the stopped thread";
+                    continue;
+                }
+                lldb::SBThread th = stopped->thread;
+
+                switch (stopped->stop_reason)
+                {
+                case lldb::eStopReasonBreakpoint:
+                {
+                    // https://lldb.llvm.org/cpp_reference/classlldb_1_1SBThread.html#af284261156e100f8d63704162f19ba76
+                    if (th.GetStopReasonDataCount() != 2)
                     {
-                    case lldb::eStopReasonBreakpoint:
+                        LOG_CAT(Debug, LldbEvent)
+                            << "Stop Reason Data Count" << th.GetStopReasonDataCount();
+                    }
+                    // TODO Handle the cane stop reason data count > 2
+                    assert(th.GetStopReasonDataCount() == 2);
+
+                    // TODO[@zmeadows][P1]: handle conversion properly, clean this all up
+                    if (target.has_value())
                     {
-                        // https://lldb.llvm.org/cpp_reference/classlldb_1_1SBThread.html#af284261156e100f8d63704162f19ba76
-                        if (th.GetStopReasonDataCount() != 2)
+                        auto breakpoint_id = lldb::break_id_t(th.GetStopReasonDataAtIndex(0));
+                        lldb::SBBreakpoint breakpoint = target->FindBreakpointByID(breakpoint_id);
+
+                        auto location_id = lldb::break_id_t(th.GetStopReasonDataAtIndex(1));
+                        lldb::SBBreakpointLocation location =
+                            breakpoint.FindLocationByID(location_id);
+
+                        if (const auto resolved = resolve_breakpoint(source_map, location);
+                            resolved.has_value())
                         {
-                            LOG(Debug) << "Stop Reason Data Count" << th.GetStopReasonDataCount();
+                            const auto& [filepath, linum] = *resolved;
+                            manually_open_and_or_focus_file(ui, open_files, filepath, linum);
                         }
-                        // TODO Handle the cane stop reason data count > 2
-                        assert(th.GetStopReasonDataCount() == 2);
+                        set_thread_frame_indices(ui, th.GetIndexID(), 0);
 
-                        // TODO[@zmeadows][P1]: handle conversion properly, clean this all up
-                        if (target.has_value())
+                        if (flame_graph.records_breakpoint_hits())
                         {
-                            auto breakpoint_id = lldb::break_id_t(th.GetStopReasonDataAtIndex(0));
-                            lldb::SBBreakpoint breakpoint =
-                                target->FindBreakpointByID(breakpoint_id);
-
-                            auto location_id = lldb::break_id_t(th.GetStopReasonDataAtIndex(1));
-                            lldb::SBBreakpointLocation location =
-                                breakpoint.FindLocationByID(location_id);
-
-                            const auto [filepath, linum] = resolve_breakpoint(location);
-                            manually_open_and_or_focus_file(ui, open_files, filepath, linum);
-                            set_thread_frame_indices(ui, i);
-                            // ui.stopped_thread_index = i;
-                            // file_viewer.set_highlight_line(linum);
+                            flame_graph.add_backtrace(th, *target);
                         }
-                        break;
+                        // ui.stopped_thread_index = i;
+                        // file_viewer.set_highlight_line(linum);
                     }
-                    // TODO: it should highlight line by line
-                    case lldb::eStopReasonPlanComplete:
+                    break;
+                }
+                // TODO: it should highlight line by line
+                case lldb::eStopReasonPlanComplete:
+                {
+                    lldb::SBFrame frame = th.GetSelectedFrame();
+                    if (const auto location = get_stop_location_from_frame(source_map, frame);
+                        location.has_value())
                     {
-                        lldb::SBFrame frame = th.GetSelectedFrame();
-                        const auto [filepath, linum] = get_stop_location_from_frame(frame);
+                        const auto& [filepath, linum] = *location;
                         manually_open_and_or_focus_file(ui, open_files, filepath, linum);
-                        set_thread_frame_indices(ui, i);
-                    }
-                    default:
-                    {
-                        continue;
-                    }
                     }
+                    set_thread_frame_indices(ui, th.GetIndexID(), frame.GetFrameID());
+                    break;
+                }
+                default:
+                {
+                    break;
+                }
                 }
             }
             else if (new_state == lldb::eStateRunning)
@@ -1565,24 +2950,34 @@ static void handle_lldb_events(
             }
             else if (new_state == lldb::eStateStepping)
             {
-                LOG(Debug) << "Thread is stepping";
+                LOG_CAT(Debug, LldbEvent) << "Thread is stepping";
             }
             else
             {
-                LOG(Debug) << "Unhandled process state encountered: " << new_state;
+                LOG_CAT(Debug, LldbEvent) << "Unhandled process state encountered: " << new_state;
             }
         }
         else
         {
             // TODO: print event description
-            LOG(Debug) << "Found non-target/process event";
+            LOG_CAT(Debug, LldbEvent) << "Found non-target/process event";
         }
     }
 }
 
 static void tick(Application& app)
 {
-    handle_lldb_events(app.debugger, app.listener, app.ui, app.open_files, app.file_viewer);
+    poll_console_command(app);
+
+    // events are left queued in the listener while an expression is evaluated
+    // or a console command runs
+    if (!app.expressions.is_busy() && !app.cmdline.is_running())
+    {
+        handle_lldb_events(
+            app.debugger, app.listener, app.ui, app.open_files, app.file_viewer, app.watchpoints,
+            app.source_map, app.disassembly, app.sampler, app.flame_graph
+        );
+    }
 
     UserInterface& ui = app.ui;
     DEBUG_STREAM(ui.window_width);
@@ -1595,6 +2990,9 @@ static void tick(Application& app)
     DEBUG_STREAM(app.fps_timer.current_fps());
 
     draw(app);
+
+    // only now that this frame is done with lldb may the queued expressions run
+    app.expressions.flush();
 }
 
 static void update_window_dimensions(UserInterface& ui)
@@ -1663,6 +3061,8 @@ int main_loop(Application& app)
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        Timer frame_timer;
+
         tick(app);
 
         ImGui::Render();
@@ -1676,6 +3076,12 @@ int main_loop(Application& app)
 
         glfwSwapBuffers(app.ui.window);
 
+        // timestamped, so stalls can be lined up with the lldb events around them
+        if (const uint64_t frame_ns = frame_timer.elapsed_ns(); frame_ns > 100000000)
+        {
+            LOG_CAT(Warning, Ui) << "Slow frame: " << frame_ns / 1000000 << " ms";
+        }
+
         // TODO: develop bettery strategy for when to read stdout,
         // possible upon receiving certain types of LLDBEvent?
         if (app.ui.frames_rendered % 10 == 0)
@@ -1767,12 +3173,21 @@ std::optional<UserInterface> UserInterface::init()
 Application::Application(const UserInterface& ui_, std::optional<fs::path> workdir)
     : debugger(lldb::SBDebugger::Create()), listener(debugger.GetListener()), cmdline(debugger),
       _stdout(StreamBuffer::StreamSource::StdOut), _stderr(StreamBuffer::StreamSource::StdErr),
-      file_browser(FileBrowserNode::create(std::move(workdir))), ui(ui_)
+      file_browser(FileBrowserNode::create(std::move(workdir))),
+      source_map(fs::path(file_browser->filepath()), file_finder), ui(ui_)
 {
+    this->source_map.synchronize(this->cmdline);
 }
 
 Application::~Application()
 {
+    this->sampler.shutdown();
+    this->expressions.shutdown();
+    this->parallel_stacks.shutdown();
+    this->symbols.shutdown();
+    this->file_finder.shutdown();
+    this->cmdline.shutdown();
+
     if (auto process = find_process(this->debugger); process.has_value() && process->IsValid())
     {
         LOG(Warning) << "Found active process while closing Application.";
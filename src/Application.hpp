@@ -1,10 +1,26 @@
 #pragma once
 
+#include "ArrayViewer.hpp"
+#include "CommandHistory.hpp"
+#include "Disassembly.hpp"
+#include "ExpressionEvaluator.hpp"
 #include "FPSTimer.hpp"
+#include "FileFinder.hpp"
 #include "FileSystem.hpp"
 #include "FileViewer.hpp"
+#include "FlameGraph.hpp"
 #include "LLDBCommandLine.hpp"
+#include "Locals.hpp"
+#include "LogView.hpp"
+#include "ParallelStacks.hpp"
+#include "Sampler.hpp"
+#include "SourceMap.hpp"
+#include "StackTrace.hpp"
 #include "StreamBuffer.hpp"
+#include "SymbolIndex.hpp"
+#include "Threads.hpp"
+#include "Tracepoints.hpp"
+#include "Watchpoints.hpp"
 
 #include <cassert>
 #include <lldb/API/LLDB.h>
@@ -27,7 +43,7 @@
 // TODO: this struct doesn't need to be publically exposed
 struct UserInterface
 {
-    uint32_t viewed_thread_index = 0;
+    uint32_t viewed_thread_index_id = 0; // lldb's stable "thread #N" id, see SBThread::GetIndexID
     uint32_t viewed_frame_index = 0;
     uint32_t viewed_breakpoint_index = 0;
 
@@ -65,13 +81,29 @@ struct Application
     lldb::SBDebugger debugger;
     lldb::SBListener listener;
     LLDBCommandLine cmdline;
+    CommandHistory command_history;
     StreamBuffer _stdout;
     StreamBuffer _stderr;
 
     OpenFiles open_files;
     std::unique_ptr<FileBrowserNode> file_browser;
+    FileFinder file_finder; // before source_map, which searches its index
+    SourceMap source_map;
     UserInterface ui;
     FileViewer file_viewer;
+    LogView log_view;
+    DisassemblyCache disassembly;
+    ThreadList threads;
+    StackTrace stack_trace;
+    ParallelStacks parallel_stacks;
+    Sampler sampler;
+    FlameGraph flame_graph;
+    LocalsTree locals;
+    WatchpointList watchpoints;
+    Tracepoints tracepoints;
+    ExpressionEvaluator expressions;
+    ArrayViewer array_viewer;
+    SymbolIndex symbols;
     FPSTimer fps_timer;
 
     Application(const UserInterface&, std::optional<fs::path>);
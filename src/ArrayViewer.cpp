@@ -0,0 +1,587 @@
+#include "ArrayViewer.hpp"
+
+#include "Defer.hpp"
+#include "Log.hpp"
+#include "StringBuffer.hpp"
+
+// clang-format off
+#include "imgui.h"
+// clang-format on
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// pointers carry no length information, so start with this many elements
+static constexpr size_t DEFAULT_POINTER_ELEMENT_COUNT = 1024;
+
+// refuse to pull absurd amounts of target memory into the debugger
+static constexpr size_t MAX_READ_BYTES = size_t(256) * 1024 * 1024;
+
+static constexpr size_t MAX_LINE_PLOT_POINTS = 4096;
+static constexpr size_t HISTOGRAM_BINS = 64;
+
+static std::optional<ArrayElementKind> integer_kind(uint64_t byte_size, bool is_signed)
+{
+    switch (byte_size)
+    {
+    case 1:
+        return is_signed ? ArrayElementKind::Int8 : ArrayElementKind::UInt8;
+    case 2:
+        return is_signed ? ArrayElementKind::Int16 : ArrayElementKind::UInt16;
+    case 4:
+        return is_signed ? ArrayElementKind::Int32 : ArrayElementKind::UInt32;
+    case 8:
+        return is_signed ? ArrayElementKind::Int64 : ArrayElementKind::UInt64;
+    default:
+        return {};
+    }
+}
+
+static std::optional<ArrayElementKind> element_kind_from_type(lldb::SBType type)
+{
+    lldb::SBType canonical = type.GetCanonicalType();
+    const uint64_t byte_size = canonical.GetByteSize();
+
+    switch (canonical.GetBasicType())
+    {
+    case lldb::eBasicTypeFloat:
+        return byte_size == 4 ? std::make_optional(ArrayElementKind::Float) : std::nullopt;
+    case lldb::eBasicTypeDouble:
+        return byte_size == 8 ? std::make_optional(ArrayElementKind::Double) : std::nullopt;
+    case lldb::eBasicTypeChar:
+    case lldb::eBasicTypeSignedChar:
+    case lldb::eBasicTypeWChar:
+    case lldb::eBasicTypeSignedWChar:
+    case lldb::eBasicTypeShort:
+    case lldb::eBasicTypeInt:
+    case lldb::eBasicTypeLong:
+    case lldb::eBasicTypeLongLong:
+        return integer_kind(byte_size, true);
+    case lldb::eBasicTypeBool:
+    case lldb::eBasicTypeUnsignedChar:
+    case lldb::eBasicTypeUnsignedWChar:
+    case lldb::eBasicTypeChar16:
+    case lldb::eBasicTypeChar32:
+    case lldb::eBasicTypeUnsignedShort:
+    case lldb::eBasicTypeUnsignedInt:
+    case lldb::eBasicTypeUnsignedLong:
+    case lldb::eBasicTypeUnsignedLongLong:
+        return integer_kind(byte_size, false);
+    default:
+        return {};
+    }
+}
+
+template <typename T> static T load_element(const uint8_t* bytes, size_t index)
+{
+    T value;
+    std::memcpy(&value, bytes + index * sizeof(T), sizeof(T));
+    return value;
+}
+
+static double element_as_double(ArrayElementKind kind, const uint8_t* bytes, size_t index)
+{
+    switch (kind)
+    {
+    case ArrayElementKind::Int8:
+        return double(load_element<int8_t>(bytes, index));
+    case ArrayElementKind::UInt8:
+        return double(load_element<uint8_t>(bytes, index));
+    case ArrayElementKind::Int16:
+        return double(load_element<int16_t>(bytes, index));
+    case ArrayElementKind::UInt16:
+        return double(load_element<uint16_t>(bytes, index));
+    case ArrayElementKind::Int32:
+        return double(load_element<int32_t>(bytes, index));
+    case ArrayElementKind::UInt32:
+        return double(load_element<uint32_t>(bytes, index));
+    case ArrayElementKind::Int64:
+        return double(load_element<int64_t>(bytes, index));
+    case ArrayElementKind::UInt64:
+        return double(load_element<uint64_t>(bytes, index));
+    case ArrayElementKind::Float:
+        return double(load_element<float>(bytes, index));
+    case ArrayElementKind::Double:
+        return load_element<double>(bytes, index);
+    }
+    return 0.;
+}
+
+// integers are formatted from the raw bytes, so 64-bit values don't lose precision
+static void
+format_element(StringBuffer& buf, ArrayElementKind kind, const uint8_t* bytes, size_t index)
+{
+    switch (kind)
+    {
+    case ArrayElementKind::Int8:
+        buf.format("{}", int(load_element<int8_t>(bytes, index)));
+        break;
+    case ArrayElementKind::UInt8:
+        buf.format("{}", unsigned(load_element<uint8_t>(bytes, index)));
+        break;
+    case ArrayElementKind::Int16:
+        buf.format("{}", load_element<int16_t>(bytes, index));
+        break;
+    case ArrayElementKind::UInt16:
+        buf.format("{}", load_element<uint16_t>(bytes, index));
+        break;
+    case ArrayElementKind::Int32:
+        buf.format("{}", load_element<int32_t>(bytes, index));
+        break;
+    case ArrayElementKind::UInt32:
+        buf.format("{}", load_element<uint32_t>(bytes, index));
+        break;
+    case ArrayElementKind::Int64:
+        buf.format("{}", load_element<int64_t>(bytes, index));
+        break;
+    case ArrayElementKind::UInt64:
+        buf.format("{}", load_element<uint64_t>(bytes, index));
+        break;
+    case ArrayElementKind::Float:
+        buf.format("{}", load_element<float>(bytes, index));
+        break;
+    case ArrayElementKind::Double:
+        buf.format("{}", load_element<double>(bytes, index));
+        break;
+    }
+}
+
+struct ResolvedArray
+{
+    lldb::SBType element_type;
+    ArrayElementKind kind;
+    lldb::addr_t address;
+    size_t count;
+    bool count_is_user_defined;
+};
+
+static std::string canonical_type_name(lldb::SBValue& value)
+{
+    const char* name = value.GetType().GetCanonicalType().GetName();
+    return name != nullptr ? std::string(name) : std::string();
+}
+
+// Resolves the element type, data pointer and length of an array, pointer or
+// contiguous container, or sets 'error' to why it can't be visualized.
+static std::optional<ResolvedArray> resolve_array(lldb::SBValue value, std::string& error)
+{
+    lldb::SBType type = value.GetType().GetCanonicalType();
+
+    lldb::SBType element_type;
+    lldb::addr_t address = LLDB_INVALID_ADDRESS;
+    size_t count = 0;
+    bool count_is_user_defined = false;
+
+    if (type.IsArrayType())
+    {
+        element_type = type.GetArrayElementType();
+        const uint64_t element_size = element_type.GetByteSize();
+        address = value.GetLoadAddress();
+        count = element_size > 0 ? size_t(type.GetByteSize() / element_size) : 0;
+    }
+    else if (type.IsPointerType())
+    {
+        element_type = type.GetPointeeType();
+        address = value.GetValueAsUnsigned(LLDB_INVALID_ADDRESS);
+        count = DEFAULT_POINTER_ELEMENT_COUNT;
+        count_is_user_defined = true;
+    }
+    else if (value.MightHaveChildren())
+    {
+        // Contiguous containers (std::vector, std::array, ...) expose their
+        // elements as synthetic children, but fetching all of them is what this
+        // viewer avoids. The elements of a synthetic provider all have the same
+        // type, so the first, second and last children are enough to check that
+        // they are laid out one after the other. Plain structs have no provider
+        // and few members, and their members must all be of the same type.
+        const uint32_t nchildren = value.GetNumChildren();
+        if (nchildren == 0)
+        {
+            error = "empty container";
+            return {};
+        }
+
+        lldb::SBValue first = value.GetChildAtIndex(0);
+        element_type = first.GetType();
+        address = first.GetLoadAddress();
+        count = nchildren;
+
+        const std::string first_type_name = canonical_type_name(first);
+        const uint64_t element_size = element_type.GetByteSize();
+
+        auto is_next_element = [&](uint32_t i)
+        {
+            lldb::SBValue child = value.GetChildAtIndex(i);
+            return canonical_type_name(child) == first_type_name &&
+                   child.GetLoadAddress() == address + i * element_size;
+        };
+
+        bool contiguous = true;
+        if (value.IsSynthetic())
+        {
+            contiguous = nchildren == 1 || (is_next_element(1) && is_next_element(nchildren - 1));
+        }
+        else
+        {
+            for (uint32_t i = 1; i < nchildren && contiguous; i++)
+            {
+                contiguous = is_next_element(i);
+            }
+        }
+
+        if (!contiguous)
+        {
+            error = "elements are not all of one type, laid out contiguously";
+            return {};
+        }
+    }
+
+    const std::optional<ArrayElementKind> kind =
+        element_type.IsValid() ? element_kind_from_type(element_type) : std::nullopt;
+
+    if (!kind.has_value() || address == LLDB_INVALID_ADDRESS || count == 0)
+    {
+        error = "not a numeric array";
+        return {};
+    }
+
+    return ResolvedArray{element_type, *kind, address, count, count_is_user_defined};
+}
+
+bool ArrayViewer::open(lldb::SBValue value)
+{
+    if (!value.IsValid())
+    {
+        return false;
+    }
+
+    const char* name = value.GetName();
+
+    std::string error;
+    std::optional<ResolvedArray> array = resolve_array(value, error);
+    if (!array.has_value())
+    {
+        LOG(Warning) << "Unable to visualize " << name << ": " << error;
+        return false;
+    }
+
+    // the value itself is only valid for this stop, it is looked up again by path
+    lldb::SBStream path;
+    if (!value.GetExpressionPath(path))
+    {
+        LOG(Warning) << "Unable to visualize " << name << ": no expression path";
+        return false;
+    }
+
+    const char* element_type_name = array->element_type.GetDisplayTypeName();
+
+    m_name = name != nullptr ? std::string(name) : std::string("<unnamed>");
+    m_path = path.GetData();
+    m_frame = value.GetFrame();
+    m_element_type_name =
+        element_type_name != nullptr ? std::string(element_type_name) : std::string();
+    m_address = array->address;
+    m_count = array->count;
+    m_element_size = size_t(array->element_type.GetCanonicalType().GetByteSize());
+    m_kind = array->kind;
+    m_count_is_user_defined = array->count_is_user_defined;
+
+    m_read_stop_id = {};
+    m_process_id = {};
+    m_raw.clear();
+    m_line_plot.clear();
+    m_histogram.clear();
+    m_stats = ArrayStatistics();
+    m_error.clear();
+    m_open = true;
+
+    return true;
+}
+
+static lldb::ByteOrder host_byte_order()
+{
+    const uint16_t probe = 1;
+    uint8_t first_byte = 0;
+    std::memcpy(&first_byte, &probe, 1);
+    return first_byte == 1 ? lldb::eByteOrderLittle : lldb::eByteOrderBig;
+}
+
+bool ArrayViewer::resolve()
+{
+    // the frame is looked up again by lldb, and is gone once the function returned
+    if (!m_frame.IsValid())
+    {
+        m_error = "the variable's function has returned";
+        return false;
+    }
+
+    // a container may have reallocated its storage or changed size since the last stop
+    std::string error;
+    std::optional<ResolvedArray> array =
+        resolve_array(m_frame.GetValueForVariablePath(m_path.c_str()), error);
+    if (!array.has_value())
+    {
+        m_error = fmt::format("unable to resolve {}: {}", m_path, error);
+        return false;
+    }
+
+    if (array->kind != m_kind ||
+        size_t(array->element_type.GetCanonicalType().GetByteSize()) != m_element_size)
+    {
+        m_error = fmt::format("the element type of {} has changed", m_path);
+        return false;
+    }
+
+    m_address = array->address;
+    if (!m_count_is_user_defined)
+    {
+        m_count = array->count;
+    }
+    return true;
+}
+
+void ArrayViewer::read(lldb::SBProcess& process)
+{
+    m_error.clear();
+
+    // elements are reinterpreted in place, which only works if the byte orders agree
+    if (process.GetByteOrder() != host_byte_order())
+    {
+        m_error = "target byte order differs from the host, unable to read elements";
+        m_raw.clear();
+        compute_statistics();
+        return;
+    }
+
+    if (!resolve())
+    {
+        m_raw.clear();
+        compute_statistics();
+        return;
+    }
+
+    size_t count = m_count;
+    if (count * m_element_size > MAX_READ_BYTES)
+    {
+        count = MAX_READ_BYTES / m_element_size;
+        m_error = fmt::format("only the first {} elements were read", count);
+    }
+
+    m_raw.resize(count * m_element_size);
+
+    lldb::SBError err;
+    const size_t nread = process.ReadMemory(m_address, m_raw.data(), m_raw.size(), err);
+
+    if (err.Fail() || nread != m_raw.size())
+    {
+        const char* err_cstr = err.GetCString();
+        m_error = fmt::format(
+            "read {} of {} bytes: {}", nread, m_raw.size(),
+            err_cstr != nullptr ? err_cstr : "unknown error"
+        );
+        m_raw.resize(nread - nread % m_element_size);
+    }
+
+    compute_statistics();
+}
+
+void ArrayViewer::compute_statistics()
+{
+    const size_t count = element_count();
+
+    m_stats = ArrayStatistics();
+    m_line_plot.clear();
+    m_histogram.assign(HISTOGRAM_BINS, 0.f);
+
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+    double sum = 0.;
+    size_t finite_count = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const double x = element_as_double(m_kind, m_raw.data(), i);
+        if (std::isnan(x))
+        {
+            m_stats.nan_count++;
+        }
+        else if (std::isinf(x))
+        {
+            m_stats.inf_count++;
+        }
+        else
+        {
+            min = std::min(min, x);
+            max = std::max(max, x);
+            sum += x;
+            finite_count++;
+        }
+    }
+
+    if (finite_count == 0)
+    {
+        return;
+    }
+
+    m_stats.min = min;
+    m_stats.max = max;
+    m_stats.mean = sum / double(finite_count);
+
+    // Downsample into buckets, keeping both the min and max of each bucket so
+    // that isolated spikes survive. Non-finite values are skipped.
+    const size_t nbuckets = std::min(count, MAX_LINE_PLOT_POINTS / 2);
+    m_line_plot.reserve(2 * nbuckets);
+    float last_value = float(m_stats.mean);
+    for (size_t b = 0; b < nbuckets; b++)
+    {
+        const size_t begin = b * count / nbuckets;
+        const size_t end = (b + 1) * count / nbuckets;
+
+        double bucket_min = std::numeric_limits<double>::max();
+        double bucket_max = std::numeric_limits<double>::lowest();
+        for (size_t i = begin; i < end; i++)
+        {
+            const double x = element_as_double(m_kind, m_raw.data(), i);
+            if (std::isfinite(x))
+            {
+                bucket_min = std::min(bucket_min, x);
+                bucket_max = std::max(bucket_max, x);
+            }
+        }
+
+        if (bucket_min <= bucket_max)
+        {
+            last_value = float(bucket_max);
+            m_line_plot.push_back(float(bucket_min));
+            m_line_plot.push_back(last_value);
+        }
+        else
+        {
+            m_line_plot.push_back(last_value);
+            m_line_plot.push_back(last_value);
+        }
+    }
+
+    const double range = max - min;
+    for (size_t i = 0; i < count; i++)
+    {
+        const double x = element_as_double(m_kind, m_raw.data(), i);
+        if (!std::isfinite(x))
+        {
+            continue;
+        }
+
+        size_t bin = range > 0. ? size_t((x - min) / range * double(HISTOGRAM_BINS)) : 0;
+        bin = std::min(bin, HISTOGRAM_BINS - 1);
+        m_histogram[bin] += 1.f;
+    }
+}
+
+void ArrayViewer::render(std::optional<lldb::SBProcess> process)
+{
+    if (!m_open)
+    {
+        return;
+    }
+
+    if (process.has_value() && process->IsValid() && process->GetState() == lldb::eStateStopped)
+    {
+        const uint32_t stop_id = process->GetStopID();
+        const uint32_t process_id = process->GetUniqueID();
+        if (m_read_stop_id != stop_id || m_process_id != process_id)
+        {
+            read(*process);
+            m_read_stop_id = stop_id;
+            m_process_id = process_id;
+        }
+    }
+
+    ImGui::SetNextWindowSize(ImVec2(600, 600), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Array Viewer", &m_open))
+    {
+        ImGui::End();
+        return;
+    }
+    Defer(ImGui::End());
+
+    StringBuffer buf;
+    buf.format("{} ({}[{}]) @ 0x{:x}", m_name, m_element_type_name, m_count, m_address);
+    ImGui::TextUnformatted(buf.data());
+    buf.clear();
+
+    if (m_count_is_user_defined)
+    {
+        int count = int(m_count);
+        if (ImGui::InputInt("element count", &count, 64, 1024,
+                            ImGuiInputTextFlags_EnterReturnsTrue) &&
+            count > 0)
+        {
+            m_count = size_t(count);
+            m_read_stop_id = {}; // re-read on the next frame
+        }
+    }
+
+    if (!m_error.empty())
+    {
+        ImGui::TextColored(
+            ImVec4(216.f / 255.f, 129.f / 255.f, 42.f / 255.f, 255.f / 255.f), "%s",
+            m_error.c_str()
+        );
+    }
+
+    buf.format(
+        "min: {}  max: {}  mean: {}  NaN: {}  inf: {}", m_stats.min, m_stats.max, m_stats.mean,
+        m_stats.nan_count, m_stats.inf_count
+    );
+    ImGui::TextUnformatted(buf.data());
+    buf.clear();
+
+    const float plot_width = ImGui::GetContentRegionAvail().x;
+    if (!m_line_plot.empty())
+    {
+        ImGui::PlotLines(
+            "##ArrayLinePlot", m_line_plot.data(), int(m_line_plot.size()), 0, nullptr,
+            float(m_stats.min), float(m_stats.max), ImVec2(plot_width, 120.f)
+        );
+        ImGui::PlotHistogram(
+            "##ArrayHistogram", m_histogram.data(), int(m_histogram.size()), 0, nullptr, 0.f,
+            FLT_MAX, ImVec2(plot_width, 80.f)
+        );
+    }
+
+    static constexpr ImGuiTableFlags table_flags =
+        ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersV;
+
+    if (ImGui::BeginTable("##ArrayValues", 2, table_flags))
+    {
+        Defer(ImGui::EndTable());
+
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("INDEX");
+        ImGui::TableSetupColumn("VALUE");
+        ImGui::TableHeadersRow();
+
+        ImGuiListClipper clipper;
+        clipper.Begin(int(element_count()));
+        while (clipper.Step())
+        {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                buf.format("{}", i);
+                ImGui::TextUnformatted(buf.data());
+                buf.clear();
+
+                ImGui::TableNextColumn();
+                format_element(buf, m_kind, m_raw.data(), size_t(i));
+                ImGui::TextUnformatted(buf.data());
+                buf.clear();
+            }
+        }
+        clipper.End();
+    }
+}
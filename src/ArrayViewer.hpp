@@ -0,0 +1,86 @@
+#pragma once
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+enum class ArrayElementKind : std::uint8_t
+{
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Int64,
+    UInt64,
+    Float,
+    Double,
+};
+
+struct ArrayStatistics
+{
+    double min = 0.;
+    double max = 0.;
+    double mean = 0.;
+    size_t nan_count = 0;
+    size_t inf_count = 0;
+};
+
+// Visualizes a numeric array, pointer or contiguous container (std::vector,
+// std::array, ...) local variable.
+//
+// Fetching elements one at a time through SBValue::GetChildAtIndex takes one
+// lldb round trip per element, which is unusable for large arrays. Instead
+// each time the process stops, the variable is looked up again by its path in
+// its frame (a std::vector may have reallocated), and the whole range is
+// pulled with a single SBProcess::ReadMemory call.
+class ArrayViewer
+{
+    std::string m_name;
+    std::string m_path; // expression path of the variable within m_frame
+    lldb::SBFrame m_frame;
+    std::string m_element_type_name;
+    lldb::addr_t m_address = LLDB_INVALID_ADDRESS;
+    size_t m_count = 0;
+    size_t m_element_size = 0;
+    ArrayElementKind m_kind = ArrayElementKind::Double;
+    bool m_count_is_user_defined = false; // pointers don't know their length
+
+    std::optional<uint32_t> m_read_stop_id = {};
+    std::optional<uint32_t> m_process_id = {};
+    std::vector<uint8_t> m_raw; // target memory, in target byte order
+    std::vector<float> m_line_plot;
+    std::vector<float> m_histogram;
+    ArrayStatistics m_stats;
+    std::string m_error;
+
+    bool m_open = false;
+
+    bool resolve();
+    void read(lldb::SBProcess& process);
+    void compute_statistics();
+
+    [[nodiscard]] size_t element_count() const
+    {
+        return m_element_size > 0 ? m_raw.size() / m_element_size : 0;
+    }
+
+  public:
+    // Resolves the element type and data pointer of the given value, returning
+    // false (and logging why) if it can't be visualized.
+    bool open(lldb::SBValue value);
+
+    // Draws the viewer window, re-reading the target memory if the process has
+    // stopped since the last read. 'process' is empty if lldb can't be used
+    // this frame, in which case the previous contents are shown.
+    void render(std::optional<lldb::SBProcess> process);
+
+    [[nodiscard]] bool is_open() const
+    {
+        return m_open;
+    }
+};
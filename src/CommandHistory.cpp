@@ -0,0 +1,255 @@
+#include "CommandHistory.hpp"
+
+#include "Log.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Rewrites the history file with only its newest 'keep_bytes' (cut at a line boundary).
+static void truncate_history_file(const fs::path& path, uint64_t size, uint64_t keep_bytes)
+{
+    std::FILE* in = std::fopen(path.string().c_str(), "rb");
+    if (in == nullptr)
+    {
+        return;
+    }
+
+    std::string tail(size_t(keep_bytes), '\0');
+    const bool read = std::fseek(in, long(size - keep_bytes), SEEK_SET) == 0 &&
+                      std::fread(tail.data(), 1, tail.size(), in) == tail.size();
+    std::fclose(in);
+    if (!read)
+    {
+        LOG(Warning) << "Failed to read command history file " << path;
+        return;
+    }
+
+    // the first line is most likely cut in half
+    tail.erase(0, std::min(tail.find('\n'), tail.size() - 1) + 1);
+
+    const fs::path tmp_path = fs::path(path).concat(".tmp");
+    std::FILE* out = std::fopen(tmp_path.string().c_str(), "wb");
+    if (out == nullptr)
+    {
+        return;
+    }
+    const bool written = std::fwrite(tail.data(), 1, tail.size(), out) == tail.size();
+    std::fclose(out);
+
+    std::error_code error;
+    if (written)
+    {
+        fs::rename(tmp_path, path, error);
+    }
+    if (!written || error)
+    {
+        LOG(Warning) << "Failed to truncate command history file " << path;
+        fs::remove(tmp_path, error);
+    }
+}
+
+CommandHistory::~CommandHistory()
+{
+    if (m_file != nullptr)
+    {
+        std::fclose(m_file);
+    }
+    unmap();
+}
+
+void CommandHistory::unmap()
+{
+#ifndef _WIN32
+    if (m_mapped != nullptr && m_contents.empty())
+    {
+        munmap(const_cast<char*>(m_mapped), m_mapped_size);
+    }
+#endif
+    m_mapped = nullptr;
+    m_mapped_size = 0;
+    m_contents.clear();
+}
+
+bool CommandHistory::open(const fs::path& path)
+{
+    std::error_code error;
+    if (const uint64_t size = fs::file_size(path, error); !error && size > MAX_FILE_BYTES)
+    {
+        truncate_history_file(path, size, MAX_FILE_BYTES / 2);
+    }
+
+    if (m_file != nullptr)
+    {
+        std::fclose(m_file);
+    }
+    unmap();
+
+    m_file = std::fopen(path.string().c_str(), "ab");
+    if (m_file == nullptr)
+    {
+        LOG(Warning) << "Failed to open command history file " << path
+                     << ", history will not be saved";
+        return false;
+    }
+
+#ifndef _WIN32
+    const int fd = ::open(path.string().c_str(), O_RDONLY);
+    struct stat info = {};
+    if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        void* mapping = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            m_mapped = static_cast<const char*>(mapping);
+            m_mapped_size = size_t(info.st_size);
+        }
+        else
+        {
+            LOG(Warning) << "Failed to map command history file " << path;
+        }
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+#else
+    if (std::FILE* in = std::fopen(path.string().c_str(), "rb"); in != nullptr)
+    {
+        char buffer[64 * 1024];
+        for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), in)) > 0;)
+        {
+            m_contents.append(buffer, n);
+        }
+        std::fclose(in);
+        m_mapped = m_contents.data();
+        m_mapped_size = m_contents.size();
+    }
+#endif
+
+    m_line_starts.clear();
+    m_scan_end = m_mapped_size;
+    m_scan_complete = m_mapped_size == 0;
+
+    // a previous session may have died halfway through writing a line
+    if (m_mapped_size > 0 && m_mapped[m_mapped_size - 1] != '\n')
+    {
+        std::fputc('\n', m_file);
+        std::fflush(m_file);
+    }
+
+    return true;
+}
+
+bool CommandHistory::index_next_line()
+{
+    while (!m_scan_complete)
+    {
+        const size_t end = size_t(m_scan_end);
+        const size_t newline = mapped().substr(0, end).rfind('\n');
+        const size_t start = newline == std::string_view::npos ? 0 : newline + 1;
+
+        if (newline == std::string_view::npos)
+        {
+            m_scan_complete = true;
+        }
+        else
+        {
+            m_scan_end = newline;
+        }
+
+        if (start < end) // skip blank lines
+        {
+            m_line_starts.push_back(start);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::optional<std::string_view> CommandHistory::entry(size_t i)
+{
+    if (i < m_session.size())
+    {
+        return m_session[m_session.size() - 1 - i];
+    }
+
+    i -= m_session.size();
+    while (i >= m_line_starts.size())
+    {
+        if (!index_next_line())
+        {
+            return {};
+        }
+    }
+
+    std::string_view line = mapped().substr(size_t(m_line_starts[i]));
+    line = line.substr(0, line.find('\n'));
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.remove_suffix(1);
+    }
+    return line;
+}
+
+std::optional<size_t> CommandHistory::search(std::string_view query, size_t start)
+{
+    for (size_t i = start;; i++)
+    {
+        const std::optional<std::string_view> command = entry(i);
+        if (!command.has_value())
+        {
+            return {};
+        }
+
+        if (command->find(query) != std::string_view::npos)
+        {
+            return i;
+        }
+    }
+}
+
+void CommandHistory::add(std::string_view command)
+{
+    if (command.empty() || command.find('\n') != std::string_view::npos)
+    {
+        return;
+    }
+
+    if (const std::optional<std::string_view> last = entry(0); last == command)
+    {
+        return;
+    }
+
+    m_session.emplace_back(command);
+
+    if (m_file != nullptr)
+    {
+        std::fwrite(command.data(), 1, command.size(), m_file);
+        std::fputc('\n', m_file);
+        std::fflush(m_file);
+    }
+}
+
+std::optional<fs::path> CommandHistory::default_path()
+{
+#ifdef _WIN32
+    const char* home = std::getenv("USERPROFILE");
+#else
+    const char* home = std::getenv("HOME");
+#endif
+    if (home == nullptr || *home == '\0')
+    {
+        return {};
+    }
+    return fs::path(home) / ".lldbg_history";
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The commands typed into the console, persisted across sessions, for up/down
+// recall and reverse search.
+//
+// The history file is one command per line and only ever appended to. At
+// startup it is memory-mapped rather than read, and nothing is parsed: the
+// line index is built backwards from the end of the file on demand, as recall
+// or a search reaches further into the past. Startup therefore costs the same
+// with 100 commands or 100k, and a session that never looks back never touches
+// the old ones. Entries are numbered from the newest (0) to the oldest.
+class CommandHistory
+{
+    // once larger, the file is cut down to its newest half when opened
+    static constexpr uint64_t MAX_FILE_BYTES = 16 * 1024 * 1024;
+
+    std::FILE* m_file = nullptr; // for appending
+
+    // the file as it was when opened
+    const char* m_mapped = nullptr;
+    size_t m_mapped_size = 0;
+    std::string m_contents; // used instead of a mapping where mmap isn't available
+
+    // offsets of the lines of the mapped file found so far, newest first
+    std::vector<uint64_t> m_line_starts;
+    uint64_t m_scan_end = 0; // where the backwards scan continues from
+    bool m_scan_complete = true;
+
+    std::vector<std::string> m_session; // commands of this session, oldest first
+
+    [[nodiscard]] std::string_view mapped() const
+    {
+        return {m_mapped, m_mapped_size};
+    }
+
+    bool index_next_line();
+    void unmap();
+
+  public:
+    CommandHistory() = default;
+    ~CommandHistory();
+
+    CommandHistory(const CommandHistory&) = delete;
+    CommandHistory(CommandHistory&&) = delete;
+    CommandHistory& operator=(const CommandHistory&) = delete;
+    CommandHistory& operator=(CommandHistory&&) = delete;
+
+    // Maps the history file at 'path' (creating it if needed) and appends new
+    // commands to it from then on. Without a file, history only lasts for the
+    // session.
+    bool open(const std::filesystem::path& path);
+
+    // Records a command, skipping empty ones and immediate repeats.
+    void add(std::string_view command);
+
+    // The 'i'th most recent command, or nothing if there are fewer commands.
+    std::optional<std::string_view> entry(size_t i);
+
+    // The most recent command containing 'query', starting at entry 'start'
+    // and going back in time. Returns its entry index.
+    std::optional<size_t> search(std::string_view query, size_t start);
+
+    // The default location of the history file: ~/.lldbg_history
+    static std::optional<std::filesystem::path> default_path();
+};
@@ -0,0 +1,104 @@
+#include "ConsoleHistory.hpp"
+
+#include <algorithm>
+#include <limits>
+
+void ConsoleHistory::add_line(ConsoleLineKind kind, std::string_view text)
+{
+    // a single line longer than 4 GB is never going to be read anyway
+    text = text.substr(0, std::numeric_limits<uint32_t>::max());
+
+    m_lines.push_back({m_arena_base + m_arena.size(), uint32_t(text.size()), kind});
+    m_arena.append(text);
+    m_entry_lines.back()++;
+}
+
+void ConsoleHistory::begin_command(std::string_view input)
+{
+    m_entry_lines.push_back(0);
+    m_line_open = false;
+
+    std::string prompt = "> ";
+    prompt.append(input);
+    add_line(ConsoleLineKind::Input, prompt);
+}
+
+void ConsoleHistory::append_output(std::string_view text)
+{
+    while (!text.empty())
+    {
+        const size_t newline = text.find('\n');
+        const std::string_view part = text.substr(0, newline);
+
+        // the open line is always the last one, at the very end of the arena
+        const uint64_t max_length = std::numeric_limits<uint32_t>::max();
+        if (m_line_open && m_lines.back().length + part.size() <= max_length)
+        {
+            m_lines.back().length += uint32_t(part.size());
+            m_arena.append(part);
+        }
+        else
+        {
+            add_line(ConsoleLineKind::Output, part);
+        }
+
+        m_line_open = newline == std::string_view::npos;
+        text.remove_prefix(std::min(part.size() + 1, text.size()));
+    }
+
+    enforce_limit();
+}
+
+void ConsoleHistory::end_command(bool succeeded, std::string_view error)
+{
+    m_line_open = false;
+
+    if (!succeeded)
+    {
+        if (!error.empty() && error.back() == '\n')
+        {
+            error.remove_suffix(1);
+        }
+
+        if (error.empty())
+        {
+            add_line(ConsoleLineKind::Error, "error: unknown failure reason");
+        }
+
+        while (!error.empty())
+        {
+            const std::string_view line = error.substr(0, error.find('\n'));
+            add_line(ConsoleLineKind::Error, line);
+            error.remove_prefix(std::min(line.size() + 1, error.size()));
+        }
+    }
+
+    enforce_limit();
+}
+
+void ConsoleHistory::enforce_limit()
+{
+    while (m_entry_lines.size() > 1 && memory_usage() > m_max_bytes)
+    {
+        for (uint32_t i = 0; i < m_entry_lines.front(); i++)
+        {
+            m_dead_bytes += m_lines.front().length;
+            m_lines.pop_front();
+        }
+        m_entry_lines.pop_front();
+    }
+
+    // lines are laid out in order, so the dropped ones are all at the front
+    if (m_dead_bytes > 0 && m_dead_bytes >= m_arena.size() / 2)
+    {
+        m_arena.erase(0, size_t(m_dead_bytes));
+        m_arena_base += m_dead_bytes;
+        m_dead_bytes = 0;
+    }
+}
+
+void ConsoleHistory::set_max_bytes(size_t max_bytes)
+{
+    m_max_bytes = max_bytes;
+    enforce_limit();
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+
+enum class ConsoleLineKind : uint8_t
+{
+    Input,  // "> command"
+    Output, // one line of a command's output
+    Error,
+};
+
+// The console's record of commands and their output, one display line at a time.
+//
+// The text of every line lives in a single append-only arena, and each line is
+// an (offset, length) pair into it, so adding a command's output is one copy
+// and drawing any line is O(1) with no per-line allocations. Once the history
+// grows past its byte limit the oldest commands are dropped as a whole; their
+// bytes are reclaimed in one go when they make up half the arena, so dropping
+// is amortized O(1) too.
+class ConsoleHistory
+{
+    struct Line
+    {
+        uint64_t offset; // absolute, counting the bytes dropped from the arena
+        uint32_t length;
+        ConsoleLineKind kind;
+    };
+
+    std::string m_arena;
+    uint64_t m_arena_base = 0; // absolute offset of m_arena[0]
+    uint64_t m_dead_bytes = 0; // at the front of the arena, belonging to dropped lines
+    std::deque<Line> m_lines;
+    std::deque<uint32_t> m_entry_lines; // number of lines per command, oldest first
+    size_t m_max_bytes = DEFAULT_MAX_BYTES;
+    bool m_line_open = false; // the last output line hasn't seen its '\n' yet
+
+    void add_line(ConsoleLineKind kind, std::string_view text);
+    void enforce_limit();
+
+  public:
+    static constexpr size_t DEFAULT_MAX_BYTES = size_t(64) * 1024 * 1024;
+
+    // A command's output may arrive in pieces while it runs, split anywhere:
+    // 'begin_command', any number of 'append_output', then 'end_command'.
+    void begin_command(std::string_view input);
+    void append_output(std::string_view text);
+    void end_command(bool succeeded, std::string_view error);
+
+    // Adds a command that has already finished.
+    void add(
+        std::string_view input, std::string_view output, bool succeeded, std::string_view error
+    )
+    {
+        begin_command(input);
+        append_output(output);
+        end_command(succeeded, error);
+    }
+
+    // Caps the text and line index kept in memory; the newest command is
+    // always kept, however large.
+    void set_max_bytes(size_t max_bytes);
+
+    [[nodiscard]] size_t line_count() const
+    {
+        return m_lines.size();
+    }
+
+    [[nodiscard]] ConsoleLineKind kind(size_t i) const
+    {
+        return m_lines[i].kind;
+    }
+
+    // not NUL-terminated
+    [[nodiscard]] std::string_view text(size_t i) const
+    {
+        const Line& line = m_lines[i];
+        return std::string_view(m_arena).substr(line.offset - m_arena_base, line.length);
+    }
+
+    [[nodiscard]] size_t memory_usage() const
+    {
+        return size_t(m_arena.size() - m_dead_bytes) + m_lines.size() * sizeof(Line);
+    }
+};
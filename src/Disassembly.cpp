@@ -0,0 +1,173 @@
+#include "Disassembly.hpp"
+
+#include "Log.hpp"
+#include "StringBuffer.hpp"
+
+#include <algorithm>
+
+// number of instructions decoded from the PC when a frame has no function or
+// symbol information to bound the range with
+static constexpr uint32_t FALLBACK_INSTRUCTION_COUNT = 64;
+
+// failures are only remembered per stop, this just bounds a stop with many frames
+static constexpr size_t MAX_FAILED_PCS = 4096;
+
+static std::string build_string(const char* cstr)
+{
+    return cstr != nullptr ? std::string(cstr) : std::string();
+}
+
+std::optional<size_t> DisassembledFunction::find_instruction(lldb::addr_t address) const
+{
+    if (!contains(address) || instructions.empty())
+    {
+        return {};
+    }
+
+    auto it = std::upper_bound(
+        instructions.begin(), instructions.end(), address,
+        [](lldb::addr_t addr, const DisassembledInstruction& inst) { return addr < inst.address; }
+    );
+
+    if (it == instructions.begin())
+    {
+        return {};
+    }
+
+    return static_cast<size_t>(std::distance(instructions.begin(), it) - 1);
+}
+
+const DisassembledFunction* DisassemblyCache::find_cached(lldb::addr_t address) const
+{
+    auto it = m_functions.upper_bound(address);
+    if (it == m_functions.begin())
+    {
+        return nullptr;
+    }
+
+    --it;
+    return it->second.contains(address) ? &it->second : nullptr;
+}
+
+std::optional<DisassembledFunction>
+DisassemblyCache::disassemble(lldb::SBTarget& target, lldb::SBFrame& frame)
+{
+    DisassembledFunction result;
+    lldb::SBInstructionList instructions;
+
+    // NOTE: no flavor is passed here so that lldb falls back to the
+    // target.x86-disassembly-flavor setting configured by LLDBCommandLine.
+    if (lldb::SBFunction function = frame.GetFunction(); function.IsValid())
+    {
+        result.start_address = function.GetStartAddress().GetLoadAddress(target);
+        result.end_address = function.GetEndAddress().GetLoadAddress(target);
+        result.name = build_string(function.GetDisplayName());
+        instructions = function.GetInstructions(target);
+    }
+    else if (lldb::SBSymbol symbol = frame.GetSymbol(); symbol.IsValid())
+    {
+        result.start_address = symbol.GetStartAddress().GetLoadAddress(target);
+        result.end_address = symbol.GetEndAddress().GetLoadAddress(target);
+        result.name = build_string(symbol.GetDisplayName());
+        instructions = symbol.GetInstructions(target);
+    }
+    else
+    {
+        lldb::SBAddress pc_address = frame.GetPCAddress();
+        result.start_address = pc_address.GetLoadAddress(target);
+        result.name = "<unknown>";
+        instructions = target.ReadInstructions(pc_address, FALLBACK_INSTRUCTION_COUNT);
+    }
+
+    if (!instructions.IsValid() || instructions.GetSize() == 0 ||
+        result.start_address == LLDB_INVALID_ADDRESS)
+    {
+        LOG(Warning) << "Failed to disassemble function: " << result.name;
+        return {};
+    }
+
+    const size_t ninstructions = instructions.GetSize();
+    result.instructions.reserve(ninstructions);
+
+    StringBuffer text;
+    for (size_t i = 0; i < ninstructions; i++)
+    {
+        lldb::SBInstruction inst = instructions.GetInstructionAtIndex(static_cast<uint32_t>(i));
+        const lldb::addr_t address = inst.GetAddress().GetLoadAddress(target);
+
+        const char* mnemonic = inst.GetMnemonic(target);
+        const char* operands = inst.GetOperands(target);
+        const char* comment = inst.GetComment(target);
+
+        text.format_(
+            "0x{:016x}  {:<8} {}", address, mnemonic != nullptr ? mnemonic : "??",
+            operands != nullptr ? operands : ""
+        );
+        if (comment != nullptr && comment[0] != '\0')
+        {
+            text.format_("    ; {}", comment);
+        }
+        text.push_back('\0');
+
+        result.instructions.push_back({address, std::string(text.data())});
+        text.clear();
+
+        if (i + 1 == ninstructions && result.end_address == LLDB_INVALID_ADDRESS)
+        {
+            result.end_address = address + inst.GetByteSize();
+        }
+    }
+
+    LOG(Verbose) << "Disassembled " << ninstructions << " instructions for: " << result.name;
+
+    return result;
+}
+
+const DisassembledFunction* DisassemblyCache::get(lldb::SBProcess& process, lldb::SBFrame frame)
+{
+    if (!process.IsValid() || !frame.IsValid())
+    {
+        return nullptr;
+    }
+
+    if (const uint32_t process_id = process.GetUniqueID(); m_process_id != process_id)
+    {
+        m_functions.clear();
+        m_failed_pcs.clear();
+        m_process_id = process_id;
+    }
+
+    if (const uint32_t stop_id = process.GetStopID(); stop_id != m_failed_stop_id)
+    {
+        m_failed_pcs.clear();
+        m_failed_stop_id = stop_id;
+    }
+
+    lldb::SBTarget target = process.GetTarget();
+    const lldb::addr_t pc = frame.GetPCAddress().GetLoadAddress(target);
+
+    if (pc == LLDB_INVALID_ADDRESS || m_failed_pcs.count(pc) > 0)
+    {
+        return nullptr;
+    }
+
+    if (const DisassembledFunction* cached = find_cached(pc); cached != nullptr)
+    {
+        return cached;
+    }
+
+    std::optional<DisassembledFunction> function = disassemble(target, frame);
+    if (!function.has_value() || !function->contains(pc))
+    {
+        if (m_failed_pcs.size() >= MAX_FAILED_PCS)
+        {
+            m_failed_pcs.clear();
+        }
+        m_failed_pcs.insert(pc);
+        return nullptr;
+    }
+
+    const lldb::addr_t start_address = function->start_address;
+    const auto [it, _] = m_functions.insert_or_assign(start_address, std::move(*function));
+    return &it->second;
+}
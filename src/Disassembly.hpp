@@ -0,0 +1,68 @@
+#pragma once
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+struct DisassembledInstruction
+{
+    lldb::addr_t address;
+    std::string text; // address, mnemonic, operands and comment, formatted once
+};
+
+// The decoded instructions of a single function (or symbol, if no debug info is
+// available), covering the load address range [start_address, end_address).
+struct DisassembledFunction
+{
+    lldb::addr_t start_address = LLDB_INVALID_ADDRESS;
+    lldb::addr_t end_address = LLDB_INVALID_ADDRESS;
+    std::string name;
+    std::vector<DisassembledInstruction> instructions;
+
+    [[nodiscard]] bool contains(lldb::addr_t address) const
+    {
+        return address >= start_address && address < end_address;
+    }
+
+    // index of the instruction containing the given address, if any
+    [[nodiscard]] std::optional<size_t> find_instruction(lldb::addr_t address) const;
+};
+
+// Disassembling a large function is expensive, so instructions are decoded once
+// per function and looked up by address range afterwards. Load addresses are
+// only meaningful for a single process, so the cache is dropped whenever the
+// process changes, and must be cleared when modules are loaded or unloaded
+// (another library may now live at a cached address).
+class DisassemblyCache
+{
+    std::map<lldb::addr_t, DisassembledFunction> m_functions; // keyed by start address
+
+    // don't retry failed disassembly every frame, but do on the next stop
+    std::unordered_set<lldb::addr_t> m_failed_pcs;
+    uint32_t m_failed_stop_id = 0;
+
+    std::optional<uint32_t> m_process_id = {};
+
+    const DisassembledFunction* find_cached(lldb::addr_t address) const;
+    std::optional<DisassembledFunction> disassemble(lldb::SBTarget& target, lldb::SBFrame& frame);
+
+  public:
+    const DisassembledFunction* get(lldb::SBProcess& process, lldb::SBFrame frame);
+
+    void clear()
+    {
+        m_functions.clear();
+        m_failed_pcs.clear();
+        m_process_id = {};
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return m_functions.size();
+    }
+};
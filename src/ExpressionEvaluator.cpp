@@ -0,0 +1,292 @@
+#include "ExpressionEvaluator.hpp"
+
+#include "Log.hpp"
+
+ExpressionEvaluator::ExpressionEvaluator() : m_worker([this]() { this->worker_loop(); }) {}
+
+ExpressionEvaluator::~ExpressionEvaluator()
+{
+    shutdown();
+}
+
+void ExpressionEvaluator::shutdown()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_shutdown)
+        {
+            return;
+        }
+
+        m_shutdown = true;
+        m_queue.clear();
+        if (!m_running_expression.empty() && m_process.IsValid())
+        {
+            m_process.SendAsyncInterrupt();
+        }
+    }
+
+    m_cv.notify_all();
+
+    if (m_worker.joinable())
+    {
+        m_worker.join();
+    }
+}
+
+void ExpressionEvaluator::set_context(
+    lldb::SBProcess& process, lldb::SBThread& thread, uint32_t frame_index
+)
+{
+    StopKey key;
+    key.stop_id = process.GetStopID();
+    key.thread_id = thread.GetThreadID();
+    key.frame_index = frame_index;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (key == m_key && m_process.IsValid() && process.GetUniqueID() == m_process.GetUniqueID())
+    {
+        return;
+    }
+
+    m_key = key;
+    m_process = process;
+    m_generation++;
+    m_queue.clear();
+    m_unflushed.clear();
+    m_results.clear();
+
+    if (m_running_expression.empty())
+    {
+        m_busy.store(false, std::memory_order_release);
+    }
+
+    // the frame is captured once per context, not looked up on every request
+    m_frame = thread.GetFrameAtIndex(frame_index);
+}
+
+ExpressionResult ExpressionEvaluator::result(const std::string& expression, bool evaluate_on_miss)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (auto it = m_results.find(expression); it != m_results.end())
+    {
+        return it->second;
+    }
+
+    if (!evaluate_on_miss)
+    {
+        return ExpressionResult();
+    }
+
+    m_results.emplace(expression, ExpressionResult());
+    m_unflushed.push_back({expression, m_frame, m_generation});
+
+    return ExpressionResult();
+}
+
+void ExpressionEvaluator::flush()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_unflushed.empty())
+        {
+            return;
+        }
+
+        for (Request& request : m_unflushed)
+        {
+            m_queue.emplace_back(std::move(request));
+        }
+        m_unflushed.clear();
+
+        m_busy.store(true, std::memory_order_release);
+    }
+
+    m_cv.notify_one();
+}
+
+void ExpressionEvaluator::cancel()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    auto mark_cancelled = [this](const Request& request)
+    {
+        if (request.generation != m_generation)
+        {
+            return;
+        }
+
+        if (auto it = m_results.find(request.expression); it != m_results.end())
+        {
+            it->second.status = ExpressionResult::Status::Cancelled;
+        }
+    };
+
+    for (const Request& request : m_queue)
+    {
+        mark_cancelled(request);
+    }
+    m_queue.clear();
+
+    for (const Request& request : m_unflushed)
+    {
+        mark_cancelled(request);
+    }
+    m_unflushed.clear();
+
+    if (!m_running_expression.empty())
+    {
+        LOG(Info) << "Interrupting expression: " << m_running_expression;
+        m_cancel_running = true;
+        m_process.SendAsyncInterrupt();
+    }
+    else
+    {
+        m_busy.store(false, std::memory_order_release);
+    }
+}
+
+std::string ExpressionEvaluator::running_expression()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_running_expression;
+}
+
+void ExpressionEvaluator::add_expression(std::string expression)
+{
+    if (expression.empty())
+    {
+        return;
+    }
+
+    if (std::find(m_expressions.begin(), m_expressions.end(), expression) == m_expressions.end())
+    {
+        m_expressions.emplace_back(std::move(expression));
+    }
+}
+
+void ExpressionEvaluator::remove_expression(size_t index)
+{
+    if (index < m_expressions.size())
+    {
+        m_expressions.erase(m_expressions.begin() + long(index));
+    }
+}
+
+void ExpressionEvaluator::reevaluate()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_generation++;
+    m_queue.clear();
+    m_unflushed.clear();
+    m_results.clear();
+}
+
+void ExpressionEvaluator::set_timeout_us(uint32_t timeout_us)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_timeout_us = timeout_us;
+}
+
+uint32_t ExpressionEvaluator::timeout_us()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_timeout_us;
+}
+
+ExpressionResult ExpressionEvaluator::evaluate(Request& request, uint32_t timeout_us)
+{
+    lldb::SBExpressionOptions options;
+    options.SetTimeoutInMicroSeconds(timeout_us);
+    options.SetUnwindOnError(true);
+    options.SetIgnoreBreakpoints(true);
+    options.SetFetchDynamicValue(lldb::eDynamicDontRunTarget);
+
+    lldb::SBValue value = request.frame.EvaluateExpression(request.expression.c_str(), options);
+
+    ExpressionResult result;
+
+    if (lldb::SBError err = value.GetError(); !value.IsValid() || err.Fail())
+    {
+        const char* err_cstr = err.GetCString();
+        result.status = ExpressionResult::Status::Failed;
+        result.error = err_cstr != nullptr ? std::string(err_cstr) : "unknown error";
+        return result;
+    }
+
+    const char* value_cstr = value.GetValue();
+    const char* summary_cstr = value.GetSummary();
+    const char* type_cstr = value.GetDisplayTypeName();
+
+    result.status = ExpressionResult::Status::Completed;
+    if (value_cstr != nullptr)
+    {
+        result.value = std::string(value_cstr);
+    }
+    else if (summary_cstr != nullptr)
+    {
+        result.value = std::string(summary_cstr);
+    }
+    else
+    {
+        result.value = "{...}";
+    }
+    result.type = type_cstr != nullptr ? std::string(type_cstr) : std::string();
+
+    return result;
+}
+
+void ExpressionEvaluator::worker_loop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_cv.wait(lock, [this]() { return m_shutdown || !m_queue.empty(); });
+
+        if (m_shutdown)
+        {
+            break;
+        }
+
+        Request request = std::move(m_queue.front());
+        m_queue.pop_front();
+
+        if (request.generation != m_generation)
+        {
+            if (m_queue.empty())
+            {
+                m_busy.store(false, std::memory_order_release);
+            }
+            continue;
+        }
+
+        m_running_expression = request.expression;
+        m_cancel_running = false;
+        const uint32_t timeout_us = m_timeout_us;
+
+        lock.unlock();
+        ExpressionResult result = evaluate(request, timeout_us);
+        lock.lock();
+
+        if (m_cancel_running)
+        {
+            result.status = ExpressionResult::Status::Cancelled;
+        }
+
+        if (request.generation == m_generation)
+        {
+            m_results[request.expression] = std::move(result);
+        }
+
+        m_running_expression.clear();
+        m_cancel_running = false;
+
+        if (m_queue.empty())
+        {
+            m_busy.store(false, std::memory_order_release);
+        }
+    }
+}
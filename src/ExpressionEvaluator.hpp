@@ -0,0 +1,133 @@
+#pragma once
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct ExpressionResult
+{
+    enum class Status : std::uint8_t
+    {
+        Pending,
+        Completed,
+        Failed,
+        Cancelled
+    };
+
+    Status status = Status::Pending;
+    std::string value;
+    std::string type;
+    std::string error;
+};
+
+// Evaluates watch expressions with SBFrame::EvaluateExpression on a background
+// thread, so that a slow or runaway expression can't hang the UI.
+//
+// Results are cached per (stop id, thread, frame), so re-rendering never
+// re-runs an expression; the cache is dropped as soon as the process stops
+// somewhere else or a different frame is viewed.
+//
+// NOTE: lldb holds the target's API mutex for the whole duration of an
+// expression evaluation, so any other SB call made from the UI thread in the
+// meantime would block. Requests are therefore only handed to the worker at
+// the end of a frame (see 'flush'), and the UI must not touch lldb while
+// 'is_busy' returns true.
+class ExpressionEvaluator
+{
+    struct StopKey
+    {
+        uint32_t stop_id = 0;
+        lldb::tid_t thread_id = 0;
+        uint32_t frame_index = 0;
+
+        friend bool operator==(const StopKey& a, const StopKey& b)
+        {
+            return a.stop_id == b.stop_id && a.thread_id == b.thread_id &&
+                   a.frame_index == b.frame_index;
+        }
+    };
+
+    struct Request
+    {
+        std::string expression;
+        lldb::SBFrame frame;
+        uint64_t generation;
+    };
+
+    std::vector<std::string> m_expressions; // the watch list, only touched by the UI thread
+
+    std::mutex m_mutex; // guards everything below, except the worker thread itself
+    std::condition_variable m_cv;
+    std::vector<Request> m_unflushed; // requests made during the current frame
+    lldb::SBFrame m_frame;
+    std::deque<Request> m_queue;
+    std::unordered_map<std::string, ExpressionResult> m_results;
+    std::string m_running_expression;
+    lldb::SBProcess m_process;
+    StopKey m_key;
+    uint64_t m_generation = 0;
+    uint32_t m_timeout_us = 1000000;
+    bool m_cancel_running = false;
+    bool m_shutdown = false;
+
+    std::atomic<bool> m_busy = false;
+
+    // declared last, so that everything the worker touches is constructed first
+    std::thread m_worker;
+
+    void worker_loop();
+    static ExpressionResult evaluate(Request& request, uint32_t timeout_us);
+
+  public:
+    ExpressionEvaluator();
+    ~ExpressionEvaluator();
+
+    ExpressionEvaluator(const ExpressionEvaluator&) = delete;
+    ExpressionEvaluator(ExpressionEvaluator&&) = delete;
+    ExpressionEvaluator& operator=(const ExpressionEvaluator&) = delete;
+    ExpressionEvaluator& operator=(ExpressionEvaluator&&) = delete;
+
+    // Re-targets the evaluator at the given frame, invalidating all cached
+    // results if the process has stopped again or a different frame is viewed.
+    void set_context(lldb::SBProcess& process, lldb::SBThread& thread, uint32_t frame_index);
+
+    // Returns a copy of the cached result, optionally queueing an evaluation on a
+    // cache miss.
+    ExpressionResult result(const std::string& expression, bool evaluate_on_miss = true);
+
+    // Hands all requests made this frame to the worker thread.
+    void flush();
+
+    // Drops all queued requests and interrupts the running expression, if any.
+    void cancel();
+
+    void shutdown();
+
+    [[nodiscard]] bool is_busy() const
+    {
+        return m_busy.load(std::memory_order_acquire);
+    }
+
+    std::string running_expression();
+
+    void add_expression(std::string expression);
+    void remove_expression(size_t index);
+    void reevaluate();
+
+    [[nodiscard]] const std::vector<std::string>& expressions() const
+    {
+        return m_expressions;
+    }
+
+    void set_timeout_us(uint32_t timeout_us);
+    uint32_t timeout_us();
+};
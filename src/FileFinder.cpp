@@ -0,0 +1,331 @@
+#include "FileFinder.hpp"
+
+#include "Defer.hpp"
+#include "FileSystem.hpp"
+#include "Log.hpp"
+#include "Timer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+static constexpr size_t FILES_PER_TASK = 8192;
+
+// bonus for matches within the file name, over matches spread across directories
+static constexpr int32_t FILENAME_MATCH_BONUS = 64;
+
+static constexpr auto PUBLISH_INTERVAL = std::chrono::milliseconds(100);
+
+static FileEntry make_entry(std::string path, size_t display_offset)
+{
+    const size_t last_separator = path.find_last_of("/\\");
+
+    FileEntry entry;
+    entry.name_offset = last_separator != std::string::npos ? uint32_t(last_separator + 1) : 0;
+    entry.display_offset = uint32_t(std::min(display_offset, size_t(entry.name_offset)));
+    entry.path = std::move(path);
+    return entry;
+}
+
+static bool is_separator(char c)
+{
+    return c == '/' || c == '\\';
+}
+
+// Collects the crawled files into the chunks of a FileIndex.
+class FileIndexBuilder
+{
+    std::vector<std::shared_ptr<const std::vector<FileEntry>>> m_chunks; // all full
+    std::vector<FileEntry> m_last;
+    size_t m_size = 0;
+
+  public:
+    // The current chunk never grows past its reservation and is moved, not
+    // copied, once full, so entries keep their address (and so do the
+    // characters of short paths stored inline) for as long as the builder lives.
+    FileIndexBuilder()
+    {
+        m_last.reserve(FileIndex::CHUNK_SIZE);
+    }
+
+    void add(FileEntry entry)
+    {
+        m_last.push_back(std::move(entry));
+        m_size++;
+
+        if (m_last.size() == FileIndex::CHUNK_SIZE)
+        {
+            m_chunks.push_back(std::make_shared<const std::vector<FileEntry>>(std::move(m_last)));
+            m_last = std::vector<FileEntry>();
+            m_last.reserve(FileIndex::CHUNK_SIZE);
+        }
+    }
+
+    template <typename F> void for_each(F&& f) const
+    {
+        for (const auto& chunk : m_chunks)
+        {
+            for (const FileEntry& entry : *chunk)
+            {
+                f(entry);
+            }
+        }
+        for (const FileEntry& entry : m_last)
+        {
+            f(entry);
+        }
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return m_size;
+    }
+
+    [[nodiscard]] std::shared_ptr<const FileIndex> snapshot() const
+    {
+        auto index = std::make_shared<FileIndex>();
+        index->chunks = m_chunks;
+        if (!m_last.empty())
+        {
+            index->chunks.push_back(std::make_shared<const std::vector<FileEntry>>(m_last));
+        }
+        index->size = m_size;
+        return index;
+    }
+};
+
+FileFinder::FileFinder() : m_pool(0) {}
+
+FileFinder::~FileFinder()
+{
+    shutdown();
+}
+
+void FileFinder::shutdown()
+{
+    m_shutdown = true;
+
+    if (m_crawler.joinable())
+    {
+        m_crawler.join();
+    }
+}
+
+std::shared_ptr<const FileIndex> FileFinder::index()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_index;
+}
+
+void FileFinder::refresh(const fs::path& root, lldb::SBTarget target)
+{
+    if (is_crawling() || m_shutdown)
+    {
+        return;
+    }
+
+    if (m_crawler.joinable())
+    {
+        m_crawler.join();
+    }
+
+    m_crawling.store(true, std::memory_order_release);
+    m_crawler = std::thread([this, root, target]() { this->crawl(root, target); });
+}
+
+void FileFinder::publish(std::shared_ptr<const FileIndex> index)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_index = std::move(index);
+}
+
+void FileFinder::crawl(fs::path root, lldb::SBTarget target)
+{
+    Defer(m_crawling.store(false, std::memory_order_release));
+
+    Timer timer;
+
+    const std::string root_str = to_utf8(root);
+    const size_t display_offset = root_str.size() + 1; // paths are shown relative to the root
+
+    FileIndexBuilder files;
+    std::unordered_set<std::string> visited;
+    size_t listed = 0;
+
+    auto last_publish = std::chrono::steady_clock::now();
+
+    std::vector<fs::path> stack = {root};
+    while (!stack.empty())
+    {
+        if (m_shutdown)
+        {
+            return;
+        }
+
+        const fs::path directory = std::move(stack.back());
+        stack.pop_back();
+
+        std::string key = to_utf8(directory);
+        std::error_code ec;
+        const fs::file_time_type mtime = fs::last_write_time(directory, ec);
+        if (ec)
+        {
+            continue;
+        }
+
+        auto it = m_directories.find(key);
+        if (it == m_directories.end() || it->second.mtime != mtime)
+        {
+            DirectoryListing listing;
+            listing.mtime = mtime;
+
+            const auto options = fs::directory_options::skip_permission_denied;
+            fs::directory_iterator entry(directory, options, ec);
+            for (; !ec && entry != fs::directory_iterator(); entry.increment(ec))
+            {
+                const fs::path& path = entry->path();
+                const std::string filename = to_utf8(path.filename());
+
+                // skips .git, .cache and friends
+                if (filename.empty() || filename[0] == '.')
+                {
+                    continue;
+                }
+
+                std::error_code type_ec;
+                if (entry->is_directory(type_ec) && !entry->is_symlink(type_ec))
+                {
+                    listing.subdirectories.push_back(path);
+                }
+                else if (entry->is_regular_file(type_ec))
+                {
+                    listing.files.push_back(to_utf8(path));
+                }
+            }
+
+            listed++;
+            it = m_directories.insert_or_assign(std::move(key), std::move(listing)).first;
+        }
+
+        visited.insert(it->first);
+
+        for (const std::string& file : it->second.files)
+        {
+            files.add(make_entry(file, display_offset));
+        }
+
+        for (const fs::path& subdirectory : it->second.subdirectories)
+        {
+            stack.push_back(subdirectory);
+        }
+
+        // let results stream in while crawling large trees
+        const auto now = std::chrono::steady_clock::now();
+        if (now - last_publish > PUBLISH_INTERVAL)
+        {
+            publish(files.snapshot());
+            last_publish = now;
+        }
+    }
+
+    // forget directories that no longer exist
+    for (auto it = m_directories.begin(); it != m_directories.end();)
+    {
+        it = visited.count(it->first) == 0 ? m_directories.erase(it) : std::next(it);
+    }
+
+    if (target.IsValid())
+    {
+        const uint32_t nmodules = target.GetNumModules();
+        if (target != m_cu_target || nmodules != m_cu_module_count)
+        {
+            m_cu_target = target;
+            m_cu_module_count = nmodules;
+            m_cu_files.clear();
+
+            for (uint32_t m = 0; m < nmodules && !m_shutdown; m++)
+            {
+                lldb::SBModule module = target.GetModuleAtIndex(m);
+                const uint32_t ncompile_units = module.GetNumCompileUnits();
+                for (uint32_t c = 0; c < ncompile_units; c++)
+                {
+                    lldb::SBFileSpec spec = module.GetCompileUnitAtIndex(c).GetFileSpec();
+                    const char* filename = spec.GetFilename();
+                    const char* directory = spec.GetDirectory();
+                    if (filename != nullptr && directory != nullptr)
+                    {
+                        const fs::path path = fs::path(directory) / fs::path(filename);
+                        m_cu_files.push_back(to_utf8(path.lexically_normal()));
+                    }
+                }
+            }
+
+            // the same sources are often compiled into several modules
+            std::sort(m_cu_files.begin(), m_cu_files.end());
+            m_cu_files.erase(std::unique(m_cu_files.begin(), m_cu_files.end()), m_cu_files.end());
+        }
+
+        // compile units under the root are usually already indexed (the views
+        // stay valid as files are added, see FileIndexBuilder)
+        std::unordered_set<std::string_view> indexed;
+        indexed.reserve(files.size());
+        files.for_each([&](const FileEntry& entry) { indexed.insert(entry.path); });
+
+        const size_t nworkdir_files = files.size();
+        for (const std::string& cu_file : m_cu_files)
+        {
+            if (indexed.count(cu_file) == 0)
+            {
+                // only whole components, i.e. /src/foo must not contain /src/foo-bar/x.c
+                const bool under_root =
+                    !root_str.empty() && cu_file.size() > root_str.size() &&
+                    cu_file.compare(0, root_str.size(), root_str) == 0 &&
+                    (is_separator(root_str.back()) || is_separator(cu_file[root_str.size()]));
+                files.add(make_entry(cu_file, under_root ? display_offset : 0));
+            }
+        }
+
+        LOG(Verbose) << "Added " << files.size() - nworkdir_files
+                     << " compile unit files to the file finder";
+    }
+
+    LOG(Verbose) << "Indexed " << files.size() << " files (" << listed << " directories listed) in "
+                 << timer.elapsed_ns() / 1000000 << " ms";
+
+    publish(files.snapshot());
+}
+
+std::vector<FuzzyMatchResult>
+FileFinder::query(const FileIndex& index, std::string_view pattern, size_t max_results)
+{
+    if (pattern.empty())
+    {
+        std::vector<FuzzyMatchResult> results;
+        const size_t n = std::min(max_results, index.size);
+        for (size_t i = 0; i < n; i++)
+        {
+            results.push_back({uint32_t(i), 0});
+        }
+        return results;
+    }
+
+    return fuzzy_top_k(
+        m_pool, index.size, FILES_PER_TASK, max_results,
+        [&](size_t i) -> std::optional<int32_t>
+        {
+            const FileEntry& entry = index.file(i);
+            std::optional<int32_t> score = fuzzy_match(pattern, entry.display());
+
+            // the file name alone usually identifies a file
+            if (std::optional<int32_t> name_score = fuzzy_match(pattern, entry.name());
+                name_score.has_value())
+            {
+                score = std::max(score.value_or(INT32_MIN), *name_score + FILENAME_MATCH_BONUS);
+            }
+
+            return score;
+        }
+    );
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "FuzzyMatch.hpp"
+#include "ThreadPool.hpp"
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct FileEntry
+{
+    std::string path;        // absolute
+    uint32_t display_offset; // start of the part shown to (and matched against) the user
+    uint32_t name_offset;    // start of the file name
+
+    [[nodiscard]] std::string_view display() const
+    {
+        return std::string_view(path).substr(display_offset);
+    }
+
+    [[nodiscard]] std::string_view name() const
+    {
+        return std::string_view(path).substr(name_offset);
+    }
+};
+
+// The indexed files, in chunks of CHUNK_SIZE. Snapshots published during a
+// crawl share all full chunks, so publishing one only copies the last,
+// partial chunk rather than every file found so far.
+struct FileIndex
+{
+    static constexpr size_t CHUNK_SIZE = 4096;
+
+    std::vector<std::shared_ptr<const std::vector<FileEntry>>> chunks;
+    size_t size = 0;
+
+    [[nodiscard]] const FileEntry& file(size_t i) const
+    {
+        return (*chunks[i / CHUNK_SIZE])[i % CHUNK_SIZE];
+    }
+};
+
+// Indexes every file under the working directory, plus the primary source
+// file of every compile unit of the target, for the Ctrl+P file finder.
+//
+// Crawling happens on a background thread, which publishes a new immutable
+// FileIndex every so often so that results stream in while it runs.
+// Refreshes are incremental: a directory is only listed again if its
+// modification time changed (which happens when entries are added, removed
+// or renamed), and compile units are only re-read when the target's modules
+// change.
+class FileFinder
+{
+    struct DirectoryListing
+    {
+        std::filesystem::file_time_type mtime;
+        std::vector<std::string> files; // full paths
+        std::vector<std::filesystem::path> subdirectories;
+    };
+
+    ThreadPool m_pool;
+
+    std::mutex m_mutex; // guards m_index
+    std::shared_ptr<const FileIndex> m_index;
+
+    // only touched by the crawler thread
+    std::unordered_map<std::string, DirectoryListing> m_directories;
+    lldb::SBTarget m_cu_target;
+    uint32_t m_cu_module_count = 0;
+    std::vector<std::string> m_cu_files;
+
+    std::atomic<bool> m_crawling = false;
+    std::atomic<bool> m_shutdown = false;
+
+    std::thread m_crawler;
+
+    void crawl(std::filesystem::path root, lldb::SBTarget target);
+    void publish(std::shared_ptr<const FileIndex> index);
+
+  public:
+    FileFinder();
+    ~FileFinder();
+
+    FileFinder(const FileFinder&) = delete;
+    FileFinder(FileFinder&&) = delete;
+    FileFinder& operator=(const FileFinder&) = delete;
+    FileFinder& operator=(FileFinder&&) = delete;
+
+    // Starts an incremental re-crawl, unless one is already running. The
+    // target may be invalid, in which case only the working directory is indexed.
+    void refresh(const std::filesystem::path& root, lldb::SBTarget target);
+
+    void shutdown();
+
+    [[nodiscard]] std::shared_ptr<const FileIndex> index();
+
+    // Returns the best 'max_results' matches (indices into FileIndex::files),
+    // best first.
+    std::vector<FuzzyMatchResult>
+    query(const FileIndex& index, std::string_view pattern, size_t max_results);
+
+    [[nodiscard]] bool is_crawling() const
+    {
+        return m_crawling.load(std::memory_order_acquire);
+    }
+};
@@ -68,7 +68,7 @@ std::optional<int> FileViewer::render()
     return clicked_line;
 }
 
-void FileViewer::synchronize_breakpoint_cache(const lldb::SBTarget& target)
+void FileViewer::synchronize_breakpoint_cache(const lldb::SBTarget& target, SourceMap& source_map)
 {
     for (auto& [_, bps] : m_breakpoint_cache)
     {
@@ -100,16 +100,16 @@ void FileViewer::synchronize_breakpoint_cache(const lldb::SBTarget& target)
             continue;
         }
 
-        // auto file_spec = line_entry.GetFileSpec();
-
-        const std::string bp_filepath = fmt::format(
-            "{}/{}", line_entry.GetFileSpec().GetDirectory(), line_entry.GetFileSpec().GetFilename()
-        );
+        const std::optional<fs::path> bp_filepath = source_map.resolve(line_entry.GetFileSpec());
+        if (!bp_filepath.has_value())
+        {
+            continue;
+        }
 
-        const auto maybe_handle = FileHandle::create(bp_filepath);
+        const auto maybe_handle = FileHandle::create(*bp_filepath);
         if (!maybe_handle)
         {
-            LOG(Error) << "Invalid filepath found for breakpoint: " << bp_filepath;
+            LOG(Error) << "Invalid filepath found for breakpoint: " << *bp_filepath;
             continue;
         }
         const FileHandle handle = *maybe_handle;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "FileSystem.hpp"
+#include "SourceMap.hpp"
 
 #include <optional>
 #include <string>
@@ -19,7 +20,7 @@ class FileViewer
   public:
     void show(FileHandle handle);
     std::optional<int> render();
-    void synchronize_breakpoint_cache(const lldb::SBTarget& target);
+    void synchronize_breakpoint_cache(const lldb::SBTarget& target, SourceMap& source_map);
 
     inline void set_highlight_line(int line)
     {
@@ -0,0 +1,504 @@
+#include "FlameGraph.hpp"
+
+#include "Defer.hpp"
+#include "Log.hpp"
+#include "StringBuffer.hpp"
+#include "Symbolication.hpp"
+#include "Timer.hpp"
+
+// clang-format off
+#include "imgui.h"
+// clang-format on
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+
+// time spent ingesting samples per frame, the rest is picked up on later frames
+static constexpr uint64_t INGEST_BUDGET_NS = 4000000;
+static constexpr size_t INGEST_BATCH = 4096;
+
+static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+static std::string to_lower(std::string_view s)
+{
+    std::string lower(s);
+    std::transform(
+        lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); }
+    );
+    return lower;
+}
+
+// the classic flame graph palette: warm colors, stable per function name
+static ImU32 frame_color(const std::string& name)
+{
+    const size_t hash = std::hash<std::string>{}(name);
+    const auto r = int(205 + hash % 50);
+    const auto g = int(80 + (hash >> 8) % 130);
+    const auto b = int((hash >> 16) % 55);
+    return IM_COL32(r, g, b, 255);
+}
+
+FlameGraph::FlameGraph()
+{
+    clear();
+
+    const char* default_export_path = "profile.collapsed";
+    std::strncpy(m_export_path.data(), default_export_path, m_export_path.size() - 1);
+}
+
+void FlameGraph::clear()
+{
+    m_frame_names.clear();
+    m_frame_by_name.clear();
+    m_frame_by_pc.clear();
+    m_frame_matches.clear();
+
+    m_nodes.clear();
+    m_child_by_key.clear();
+    m_leaf_by_stack.clear();
+
+    FlameNode root;
+    root.frame = uint32_t(m_frame_names.size());
+    root.parent = NO_NODE;
+    root.depth = 0;
+    m_frame_names.emplace_back("all");
+    m_nodes.push_back(root);
+
+    m_max_depth = 0;
+    m_zoom = ROOT;
+    m_matched_samples = 0;
+    m_dirty = true;
+}
+
+uint32_t FlameGraph::intern_frame(lldb::SBTarget& target, lldb::addr_t pc, bool is_leaf)
+{
+    // return addresses may already belong to the next function (after a call
+    // to a noreturn function), so they are looked up one byte earlier
+    const lldb::addr_t lookup_pc = is_leaf ? pc : pc - 1;
+
+    if (auto it = m_frame_by_pc.find(lookup_pc); it != m_frame_by_pc.end())
+    {
+        return it->second;
+    }
+
+    std::string name = resolve_function_name(target, lookup_pc);
+
+    uint32_t frame;
+    if (auto it = m_frame_by_name.find(name); it != m_frame_by_name.end())
+    {
+        frame = it->second;
+    }
+    else
+    {
+        frame = uint32_t(m_frame_names.size());
+        m_frame_names.push_back(name);
+        m_frame_by_name.emplace(std::move(name), frame);
+    }
+
+    m_frame_by_pc.emplace(lookup_pc, frame);
+    return frame;
+}
+
+uint32_t FlameGraph::insert(lldb::SBTarget& target, const lldb::addr_t* pcs, uint32_t depth)
+{
+    uint32_t node = ROOT;
+
+    for (uint32_t i = 0; i < depth; i++)
+    {
+        const uint32_t frame = intern_frame(target, pcs[i], i + 1 == depth);
+        const uint64_t key = (uint64_t(node) << 32) | frame;
+
+        if (auto it = m_child_by_key.find(key); it != m_child_by_key.end())
+        {
+            node = it->second;
+            continue;
+        }
+
+        FlameNode child;
+        child.frame = frame;
+        child.parent = node;
+        child.depth = m_nodes[node].depth + 1;
+        m_max_depth = std::max(m_max_depth, child.depth);
+
+        // children are kept sorted by name, so drawing is stable as samples come in
+        const auto index = uint32_t(m_nodes.size());
+        std::vector<uint32_t>& siblings = m_nodes[node].children;
+        const auto position = std::lower_bound(
+            siblings.begin(), siblings.end(), m_frame_names[frame],
+            [this](uint32_t sibling, const std::string& name)
+            { return m_frame_names[m_nodes[sibling].frame] < name; }
+        );
+        siblings.insert(position, index);
+        m_nodes.push_back(std::move(child));
+        m_child_by_key.emplace(key, index);
+        node = index;
+    }
+
+    return node;
+}
+
+void FlameGraph::ingest(Sampler& sampler, lldb::SBTarget& target)
+{
+    const uint32_t session = sampler.stats().session;
+    if (session != m_session)
+    {
+        clear();
+        m_session = session;
+        m_ingested = 0;
+    }
+
+    Timer timer;
+
+    sampler.read(
+        [&](const SampleStore& store)
+        {
+            const std::vector<Sample>& samples = store.samples();
+            m_leaf_by_stack.resize(store.unique_stacks(), NO_NODE);
+
+            while (m_ingested < samples.size())
+            {
+                if (m_ingested % INGEST_BATCH == 0 && timer.elapsed_ns() > INGEST_BUDGET_NS)
+                {
+                    break;
+                }
+
+                const Sample& sample = samples[m_ingested++];
+
+                // only the first sample of each unique stack walks the tree
+                uint32_t& leaf = m_leaf_by_stack[sample.stack];
+                if (leaf == NO_NODE)
+                {
+                    const SampleStack& stack = store.stack(sample.stack);
+                    leaf = insert(target, store.pcs(stack), stack.depth);
+                }
+
+                m_nodes[leaf].self++;
+                m_dirty = true;
+            }
+        }
+    );
+}
+
+void FlameGraph::add_backtrace(lldb::SBThread& thread, lldb::SBTarget& target)
+{
+    std::vector<lldb::addr_t> pcs;
+    for (uint32_t f = 0; f < Sampler::MAX_FRAMES; f++)
+    {
+        lldb::SBFrame frame = thread.GetFrameAtIndex(f);
+        if (!frame.IsValid())
+        {
+            break;
+        }
+        pcs.push_back(frame.GetPC());
+    }
+    std::reverse(pcs.begin(), pcs.end());
+
+    const uint32_t leaf = insert(target, pcs.data(), uint32_t(pcs.size()));
+    m_nodes[leaf].self++;
+    m_dirty = true;
+}
+
+void FlameGraph::update()
+{
+    if (!m_dirty)
+    {
+        return;
+    }
+    m_dirty = false;
+
+    for (FlameNode& node : m_nodes)
+    {
+        node.total = node.self;
+    }
+
+    for (size_t i = m_nodes.size() - 1; i > ROOT; i--)
+    {
+        m_nodes[m_nodes[i].parent].total += m_nodes[i].total;
+    }
+
+    update_search();
+}
+
+void FlameGraph::update_search()
+{
+    // only the frames interned since the last update are matched, changing the
+    // pattern clears 'm_frame_matches' to start over
+    const size_t first_unmatched = m_frame_matches.size();
+    m_frame_matches.resize(m_frame_names.size(), false);
+    m_matched_samples = 0;
+
+    if (m_search[0] == '\0')
+    {
+        return;
+    }
+
+    for (size_t i = first_unmatched; i < m_frame_names.size(); i++)
+    {
+        m_frame_matches[i] = to_lower(m_frame_names[i]).find(m_search_lower) != std::string::npos;
+    }
+
+    // a sample counts once, however many of its frames match
+    std::vector<bool> covered(m_nodes.size(), false);
+    for (size_t i = ROOT + 1; i < m_nodes.size(); i++)
+    {
+        const FlameNode& node = m_nodes[i];
+        const bool parent_covered = covered[node.parent];
+        covered[i] = parent_covered || m_frame_matches[node.frame];
+        if (!parent_covered && covered[i])
+        {
+            m_matched_samples += node.total;
+        }
+    }
+}
+
+bool FlameGraph::export_collapsed(const std::filesystem::path& path) const
+{
+    std::ofstream out(path);
+    if (!out)
+    {
+        LOG(Error) << "Failed to open file for writing: " << path;
+        return false;
+    }
+
+    struct Entry
+    {
+        uint32_t node;
+        size_t prefix_length; // of the path of its parent
+    };
+
+    std::string stack_path;
+    std::vector<Entry> pending;
+    for (const uint32_t child : m_nodes[ROOT].children)
+    {
+        pending.push_back({child, 0});
+    }
+
+    size_t lines = 0;
+    while (!pending.empty())
+    {
+        const Entry entry = pending.back();
+        pending.pop_back();
+
+        const FlameNode& node = m_nodes[entry.node];
+        stack_path.resize(entry.prefix_length);
+        if (!stack_path.empty())
+        {
+            stack_path.push_back(';');
+        }
+
+        // ';' separates frames and a line ends each stack
+        for (const char c : m_frame_names[node.frame])
+        {
+            stack_path.push_back(c == ';' ? ':' : (c == '\n' ? ' ' : c));
+        }
+
+        if (node.self > 0)
+        {
+            out << stack_path << ' ' << node.self << '\n';
+            lines++;
+        }
+
+        for (const uint32_t child : node.children)
+        {
+            pending.push_back({child, stack_path.size()});
+        }
+    }
+
+    LOG(Info) << "Exported " << lines << " collapsed stacks to " << path;
+    return true;
+}
+
+void FlameGraph::draw_graph()
+{
+    const float row_height = ImGui::GetTextLineHeightWithSpacing();
+    const float width = ImGui::GetContentRegionAvail().x;
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const float visible_min_y = ImGui::GetWindowPos().y;
+    const float visible_max_y = visible_min_y + ImGui::GetWindowHeight();
+    const ImVec2 mouse = ImGui::GetMousePos();
+    const bool window_hovered = ImGui::IsWindowHovered();
+    const bool searching = m_search[0] != '\0';
+    const uint64_t root_total = m_nodes[ROOT].total;
+
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    uint32_t hovered = NO_NODE;
+
+    auto draw_node = [&](uint32_t n, float x, float w)
+    {
+        const FlameNode& node = m_nodes[n];
+        const ImVec2 min(origin.x + x, origin.y + float(node.depth) * row_height);
+        const ImVec2 max(min.x + w, min.y + row_height);
+        if (max.y < visible_min_y || min.y > visible_max_y)
+        {
+            return;
+        }
+
+        const std::string& name = m_frame_names[node.frame];
+        ImU32 color = frame_color(name);
+        if (searching)
+        {
+            color = m_frame_matches[node.frame] ? IM_COL32(230, 60, 200, 255)
+                                                : IM_COL32(120, 120, 120, 255);
+        }
+        draw_list->AddRectFilled(min, ImVec2(max.x - 1.f, max.y - 1.f), color);
+
+        if (w > 3.f * ImGui::GetFontSize())
+        {
+            draw_list->PushClipRect(min, ImVec2(max.x - 2.f, max.y), true);
+            draw_list->AddText(
+                ImVec2(min.x + 2.f, min.y + 1.f), IM_COL32(0, 0, 0, 255), name.c_str()
+            );
+            draw_list->PopClipRect();
+        }
+
+        if (window_hovered && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y &&
+            mouse.y < max.y)
+        {
+            hovered = n;
+        }
+    };
+
+    // the zoomed-in node spans the whole width, with its ancestors above it
+    for (uint32_t n = m_nodes[m_zoom].parent; n != NO_NODE; n = m_nodes[n].parent)
+    {
+        draw_node(n, 0.f, width);
+    }
+
+    struct Pending
+    {
+        uint32_t node;
+        float x;
+        float w;
+    };
+
+    std::vector<Pending> pending = {{m_zoom, 0.f, width}};
+    while (!pending.empty())
+    {
+        const Pending p = pending.back();
+        pending.pop_back();
+
+        const FlameNode& node = m_nodes[p.node];
+        draw_node(p.node, p.x, p.w);
+
+        // deeper rows are further down, and narrower frames stay narrower
+        if (node.total == 0 || origin.y + float(node.depth + 1) * row_height > visible_max_y)
+        {
+            continue;
+        }
+
+        float x = p.x;
+        for (const uint32_t child : node.children)
+        {
+            const float w = p.w * float(m_nodes[child].total) / float(node.total);
+            if (w >= 1.f)
+            {
+                pending.push_back({child, x, w});
+            }
+            x += w;
+        }
+    }
+
+    ImGui::Dummy(ImVec2(width, float(m_max_depth + 1) * row_height));
+
+    if (hovered != NO_NODE)
+    {
+        const FlameNode& node = m_nodes[hovered];
+        const double percent =
+            root_total > 0 ? 100.0 * double(node.total) / double(root_total) : 0.0;
+
+        StringBuffer buf;
+        buf.format(
+            "{}\n{} samples ({:.2f}%), {} in the function itself", m_frame_names[node.frame],
+            node.total, percent, node.self
+        );
+        ImGui::SetTooltip("%s", buf.data());
+
+        if (ImGui::IsMouseClicked(0))
+        {
+            m_zoom = hovered;
+        }
+    }
+
+    if (window_hovered && (ImGui::IsMouseClicked(1) || ImGui::IsKeyPressed(ImGuiKey_Escape)) &&
+        m_zoom != ROOT)
+    {
+        m_zoom = m_nodes[m_zoom].parent;
+    }
+}
+
+void FlameGraph::render(std::optional<lldb::SBTarget> target, Sampler& sampler)
+{
+    if (!m_open)
+    {
+        return;
+    }
+
+    if (target.has_value() && target->IsValid())
+    {
+        ingest(sampler, *target);
+    }
+    update();
+
+    ImGui::SetNextWindowSize(ImVec2(900, 500), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Flame Graph", &m_open))
+    {
+        ImGui::End();
+        return;
+    }
+    Defer(ImGui::End());
+
+    ImGui::SetNextItemWidth(ImGui::CalcTextSize("0000000000000000000000000").x);
+    if (ImGui::InputTextWithHint("##FlameSearch", "search", m_search.data(), m_search.size()))
+    {
+        m_search_lower = to_lower(m_search.data());
+        m_frame_matches.clear();
+        update_search();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("reset zoom"))
+    {
+        m_zoom = ROOT;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("clear"))
+    {
+        clear();
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("record breakpoint hits", &m_record_breakpoint_hits);
+
+    ImGui::SetNextItemWidth(ImGui::CalcTextSize("0000000000000000000000000").x);
+    ImGui::InputText("##FlameExportPath", m_export_path.data(), m_export_path.size());
+    ImGui::SameLine();
+    if (ImGui::Button("export collapsed stacks"))
+    {
+        export_collapsed(std::filesystem::path(m_export_path.data()));
+    }
+
+    StringBuffer buf;
+    buf.format_(
+        "{} samples, {} functions, {} nodes", m_nodes[ROOT].total, m_frame_names.size() - 1,
+        m_nodes.size() - 1
+    );
+    if (const size_t sampled = sampler.stats().samples;
+        !sampler.is_active() && m_ingested < sampled)
+    {
+        buf.format_(" (aggregating {}/{})", m_ingested, sampled);
+    }
+    if (m_search[0] != '\0' && m_nodes[ROOT].total > 0)
+    {
+        buf.format_(
+            ", search matches {:.2f}%",
+            100.0 * double(m_matched_samples) / double(m_nodes[ROOT].total)
+        );
+    }
+    buf.push_back('\0');
+    ImGui::TextDisabled("%s", buf.data());
+    buf.clear();
+
+    ImGui::BeginChild("##FlameGraph", ImVec2(0, 0));
+    draw_graph();
+    ImGui::EndChild();
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Sampler.hpp"
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct FlameNode
+{
+    uint32_t frame; // index into the interned frame table
+    uint32_t parent;
+    uint32_t depth;
+    uint64_t self = 0;  // samples whose innermost frame this is
+    uint64_t total = 0; // self plus the samples of all descendants
+    std::vector<uint32_t> children;
+};
+
+// Aggregates backtraces, from the Sampler or from breakpoint hits, into a
+// prefix tree of functions, rooted at the outermost frames.
+//
+// Frames are interned per function, and each unique backtrace of the sample
+// store is only inserted into the tree once; after that a sample just bumps
+// its leaf's self count. Totals are re-accumulated in a single pass over the
+// nodes (children always come after their parents) when they are next drawn;
+// children are inserted in name order and only new frames are matched against
+// the search, so nothing is re-sorted or re-matched as the graph grows.
+// Samples are ingested under a per-frame time budget, so a million of them
+// never stall the UI.
+class FlameGraph
+{
+    static constexpr uint32_t ROOT = 0; // a virtual node, not a real frame
+
+    std::vector<std::string> m_frame_names;
+    std::unordered_map<std::string, uint32_t> m_frame_by_name;
+    std::unordered_map<lldb::addr_t, uint32_t> m_frame_by_pc;
+
+    std::vector<FlameNode> m_nodes;
+    std::unordered_map<uint64_t, uint32_t> m_child_by_key; // (parent, frame) -> node
+    uint32_t m_max_depth = 0;
+    bool m_dirty = false;
+
+    // how far the sampler's current session has been ingested
+    uint32_t m_session = 0;
+    size_t m_ingested = 0;
+    std::vector<uint32_t> m_leaf_by_stack; // SampleStore stack -> leaf node
+
+    bool m_open = false;
+    bool m_record_breakpoint_hits = false;
+    uint32_t m_zoom = ROOT;
+    std::array<char, 256> m_search = {};
+    std::string m_search_lower;
+    std::vector<bool> m_frame_matches; // per frame, against m_search
+    uint64_t m_matched_samples = 0;
+    std::array<char, 512> m_export_path = {};
+
+    uint32_t intern_frame(lldb::SBTarget& target, lldb::addr_t pc, bool is_leaf);
+    uint32_t insert(lldb::SBTarget& target, const lldb::addr_t* pcs, uint32_t depth);
+    void ingest(Sampler& sampler, lldb::SBTarget& target);
+    void update();
+    void update_search();
+    void draw_graph();
+
+  public:
+    FlameGraph();
+
+    void clear();
+
+    void open()
+    {
+        m_open = true;
+    }
+
+    [[nodiscard]] bool is_open() const
+    {
+        return m_open;
+    }
+
+    [[nodiscard]] bool records_breakpoint_hits() const
+    {
+        return m_record_breakpoint_hits;
+    }
+
+    // Adds the current backtrace of a stopped thread as a single sample.
+    void add_backtrace(lldb::SBThread& thread, lldb::SBTarget& target);
+
+    // Writes one "outermost;...;innermost count" line per unique stack, the
+    // "collapsed" format of Brendan Gregg's flamegraph.pl and friends.
+    bool export_collapsed(const std::filesystem::path& path) const;
+
+    // Draws the flame graph window, first ingesting new samples from the
+    // sampler. 'target' is empty if lldb can't be used this frame, in which
+    // case ingestion waits.
+    void render(std::optional<lldb::SBTarget> target, Sampler& sampler);
+};
@@ -0,0 +1,132 @@
+#include "FuzzyMatch.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+static constexpr int32_t SCORE_MATCH = 16;
+static constexpr int32_t BONUS_BOUNDARY = 24;
+static constexpr int32_t BONUS_CONSECUTIVE = 16;
+static constexpr int32_t BONUS_FIRST_CHAR = 32;
+static constexpr int32_t PENALTY_GAP = 1;
+static constexpr int32_t MAX_GAP_PENALTY = 8;
+
+static char lower(char c)
+{
+    return char(std::tolower(static_cast<unsigned char>(c)));
+}
+
+static bool is_boundary(std::string_view s, size_t i)
+{
+    if (i == 0)
+    {
+        return true;
+    }
+
+    const char prev = s[i - 1];
+    const char cur = s[i];
+
+    switch (prev)
+    {
+    case '_':
+    case ':':
+    case '/':
+    case '\\':
+    case '.':
+    case '-':
+    case ' ':
+    case '(':
+    case '<':
+    case ',':
+        return true;
+    default:
+        break;
+    }
+
+    return std::islower(static_cast<unsigned char>(prev)) &&
+           std::isupper(static_cast<unsigned char>(cur));
+}
+
+std::optional<int32_t> fuzzy_match(std::string_view pattern, std::string_view candidate)
+{
+    if (pattern.empty())
+    {
+        return 0;
+    }
+
+    if (pattern.size() > candidate.size())
+    {
+        return {};
+    }
+
+    // forward pass: find the end of the earliest complete match
+    size_t p = 0;
+    size_t end = 0;
+    for (size_t i = 0; i < candidate.size(); i++)
+    {
+        if (lower(candidate[i]) == lower(pattern[p]))
+        {
+            p++;
+            if (p == pattern.size())
+            {
+                end = i + 1;
+                break;
+            }
+        }
+    }
+
+    if (p != pattern.size())
+    {
+        return {};
+    }
+
+    // backward pass: tighten the start of the match window as much as possible
+    size_t start = end;
+    p = pattern.size();
+    while (p > 0)
+    {
+        start--;
+        if (lower(candidate[start]) == lower(pattern[p - 1]))
+        {
+            p--;
+        }
+    }
+
+    // score the (greedy) match within the window
+    int32_t score = 0;
+    size_t last_match = start;
+    bool previous_matched = false;
+    p = 0;
+    for (size_t i = start; i < end && p < pattern.size(); i++)
+    {
+        if (lower(candidate[i]) != lower(pattern[p]))
+        {
+            previous_matched = false;
+            continue;
+        }
+
+        score += SCORE_MATCH;
+
+        if (is_boundary(candidate, i))
+        {
+            score += p == 0 ? BONUS_FIRST_CHAR : BONUS_BOUNDARY;
+        }
+
+        if (previous_matched)
+        {
+            score += BONUS_CONSECUTIVE;
+        }
+        else if (p > 0)
+        {
+            score -= std::min(MAX_GAP_PENALTY, PENALTY_GAP * int32_t(i - last_match));
+        }
+
+        previous_matched = true;
+        last_match = i;
+        p++;
+    }
+
+    // prefer shorter candidates among otherwise equal matches
+    score -= int32_t(std::min(candidate.size(), size_t(255)) / 8);
+
+    return score;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Case-insensitive subsequence matching, in the spirit of fzf/Sublime's "goto
+// anything". Returns std::nullopt if not every character of 'pattern' appears
+// in 'candidate' in order, and a score otherwise (higher is better).
+//
+// Matches at word boundaries (after '_', ':', '/', '.', ..., or a lower to
+// upper case transition) and runs of consecutive characters are preferred,
+// and so are shorter candidates.
+std::optional<int32_t> fuzzy_match(std::string_view pattern, std::string_view candidate);
+
+struct FuzzyMatchResult
+{
+    uint32_t index; // of the candidate
+    int32_t score;
+};
+
+// Calls 'score(i)' for every candidate index in [0, count), in parallel chunks
+// of 'chunk_size' on the pool, and returns the best 'max_results' candidates
+// that matched, best first. Ties are broken by index, so the result is stable.
+// Each chunk only keeps its own best results before they are merged.
+template <typename ScoreFn>
+std::vector<FuzzyMatchResult> fuzzy_top_k(
+    ThreadPool& pool, size_t count, size_t chunk_size, size_t max_results, ScoreFn&& score
+)
+{
+    auto better = [](const FuzzyMatchResult& a, const FuzzyMatchResult& b)
+    { return a.score > b.score || (a.score == b.score && a.index < b.index); };
+
+    std::vector<FuzzyMatchResult> results;
+    std::mutex results_mutex;
+
+    pool.parallel_for(
+        count, chunk_size,
+        [&](size_t begin, size_t end)
+        {
+            std::vector<FuzzyMatchResult> local;
+            for (size_t i = begin; i < end; i++)
+            {
+                if (std::optional<int32_t> s = score(i); s.has_value())
+                {
+                    local.push_back({uint32_t(i), *s});
+                }
+            }
+
+            if (local.size() > max_results)
+            {
+                std::partial_sort(
+                    local.begin(), local.begin() + long(max_results), local.end(), better
+                );
+                local.resize(max_results);
+            }
+
+            std::unique_lock<std::mutex> lock(results_mutex);
+            results.insert(results.end(), local.begin(), local.end());
+        }
+    );
+
+    const size_t n = std::min(max_results, results.size());
+    std::partial_sort(results.begin(), results.begin() + long(n), results.end(), better);
+    results.resize(n);
+
+    return results;
+}
@@ -2,6 +2,13 @@
 
 #include "Log.hpp"
 
+#include <array>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 // TODO: smart user completion using the HandleCompletionWithDescriptions functions
 
 LLDBCommandLine::LLDBCommandLine(lldb::SBDebugger& debugger)
@@ -13,6 +20,27 @@ LLDBCommandLine::LLDBCommandLine(lldb::SBDebugger& debugger)
     run_command("settings set target.x86-disassembly-flavor intel", true);
 }
 
+LLDBCommandLine::~LLDBCommandLine()
+{
+    shutdown();
+}
+
+void LLDBCommandLine::shutdown()
+{
+    if (m_running == nullptr)
+    {
+        return;
+    }
+
+    interrupt();
+    m_running->worker.join();
+    if (m_running->reader.joinable())
+    {
+        m_running->reader.join();
+    }
+    m_running.reset();
+}
+
 lldb::SBCommandReturnObject
 LLDBCommandLine::run_command(const char* command, bool hide_from_history)
 {
@@ -24,37 +52,163 @@ LLDBCommandLine::run_command(const char* command, bool hide_from_history)
         return ret;
     }
 
-    CommandLineEntry entry;
-    entry.input = std::string(command);
+    if (m_running != nullptr)
+    {
+        LOG(Warning) << "Ignoring command '" << command << "' while '" << m_running->command
+                     << "' is running";
+        auto ret = lldb::SBCommandReturnObject();
+        ret.SetStatus(lldb::eReturnStatusInvalid);
+        return ret;
+    }
 
     lldb::SBCommandReturnObject ret;
     m_interpreter.HandleCommand(command, ret);
 
-    if (ret.GetOutput() != nullptr)
+    if (!hide_from_history)
+    {
+        const char* output = ret.GetOutput();
+        const char* error = ret.GetError();
+        m_history.add(
+            command, output != nullptr ? output : "", ret.Succeeded(),
+            error != nullptr ? error : ""
+        );
+    }
+
+    return ret;
+}
+
+bool LLDBCommandLine::start_command(const char* command)
+{
+    if (command == nullptr || m_running != nullptr)
+    {
+        LOG(Warning) << "Attempted to start a command while another one is running!";
+        return false;
+    }
+
+    auto running = std::make_unique<RunningCommand>();
+    running->command = command;
+
+#ifndef _WIN32
+    std::array<int, 2> fds = {};
+    if (pipe(fds.data()) == 0)
     {
-        entry.output = std::string(ret.GetOutput());
+        running->pipe_writer = fdopen(fds[1], "w");
+        if (running->pipe_writer == nullptr)
+        {
+            close(fds[0]);
+            close(fds[1]);
+        }
     }
 
-    entry.succeeded = ret.Succeeded();
+    if (running->pipe_writer != nullptr)
+    {
+        // flushed per line, so slow commands show their output as they go
+        std::setvbuf(running->pipe_writer, nullptr, _IOLBF, 0);
+        running->result.SetImmediateOutputFile(running->pipe_writer, false);
+
+        running->reader = std::thread(
+            [fd = fds[0], r = running.get()]()
+            {
+                std::array<char, 64 * 1024> buffer;
+                for (;;)
+                {
+                    const ssize_t n = read(fd, buffer.data(), buffer.size());
+                    if (n < 0 && errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if (n <= 0)
+                    {
+                        break;
+                    }
 
-    if (!entry.succeeded)
+                    std::lock_guard<std::mutex> lock(r->mutex);
+                    r->output.append(buffer.data(), size_t(n));
+                }
+                close(fd);
+            }
+        );
+    }
+    else
     {
-        if (ret.GetError() != nullptr)
+        LOG(Warning) << "Failed to create a pipe, the output of '" << command
+                     << "' will only show once it has finished";
+    }
+#endif
+
+    m_history.begin_command(command);
+
+    running->worker = std::thread(
+        [this, r = running.get()]()
         {
-            entry.error_msg = std::string(ret.GetError());
+            m_interpreter.HandleCommand(r->command.c_str(), r->result);
+            if (r->pipe_writer != nullptr)
+            {
+                std::fclose(r->pipe_writer); // the reader sees the end of the pipe
+            }
+            r->finished.store(true, std::memory_order_release);
         }
-        else
+    );
+
+    m_running = std::move(running);
+    return true;
+}
+
+std::optional<lldb::SBCommandReturnObject> LLDBCommandLine::poll()
+{
+    if (m_running == nullptr)
+    {
+        return {};
+    }
+
+    RunningCommand& running = *m_running;
+    const bool finished = running.finished.load(std::memory_order_acquire);
+    if (finished)
+    {
+        running.worker.join();
+        if (running.reader.joinable())
         {
-            entry.error_msg = "Unknown failure reason!";
+            running.reader.join(); // only has the rest of the pipe left to read
         }
     }
 
-    if (!hide_from_history)
+    std::string output;
     {
-        m_history.emplace_back(std::move(entry));
+        std::lock_guard<std::mutex> lock(running.mutex);
+        output.swap(running.output);
     }
+    m_history.append_output(output);
 
-    return ret;
+    if (!finished)
+    {
+        return {};
+    }
+
+    if (running.pipe_writer == nullptr)
+    {
+        const char* unstreamed = running.result.GetOutput();
+        m_history.append_output(unstreamed != nullptr ? unstreamed : "");
+    }
+
+    const char* error = running.result.GetError();
+    m_history.end_command(running.result.Succeeded(), error != nullptr ? error : "");
+
+    lldb::SBCommandReturnObject result = running.result;
+    m_running.reset();
+    return result;
+}
+
+void LLDBCommandLine::interrupt()
+{
+    if (m_running == nullptr)
+    {
+        return;
+    }
+
+    if (m_interpreter.InterruptCommand())
+    {
+        LOG_CAT(Info, Lldb) << "Interrupting '" << m_running->command << "'";
+    }
 }
 
 std::optional<std::string> LLDBCommandLine::expand_and_unalias_command(const char* command)
@@ -1,34 +1,85 @@
 #pragma once
 
+#include "ConsoleHistory.hpp"
+
 #include "lldb/API/LLDB.h" // IWYU pragma: keep
 
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
-#include <vector>
-
-// TODO: convert to variant to represent either user command, stdout, sterr, or log
-// message
-struct CommandLineEntry
-{
-    std::string input;
-    std::string output;
-    std::string error_msg; // TODO: use std::optional and eliminate 'succeeded' bool
-    bool succeeded;
-};
+#include <thread>
 
 class LLDBCommandLine
 {
+    // A command running on a background thread. lldb writes its output to a
+    // pipe as it is produced, and a reader thread empties the pipe into
+    // 'output' so that lldb never blocks on a full pipe, however slowly the UI
+    // picks the output up.
+    struct RunningCommand
+    {
+        std::string command;
+        lldb::SBCommandReturnObject result;
+        std::FILE* pipe_writer = nullptr; // null if the output isn't streamed
+
+        std::mutex mutex;
+        std::string output; // read from the pipe, not yet moved into the history
+
+        std::atomic<bool> finished = false;
+        std::thread reader;
+        std::thread worker;
+    };
+
     lldb::SBCommandInterpreter m_interpreter;
-    std::vector<CommandLineEntry> m_history;
+    ConsoleHistory m_history;
+    std::unique_ptr<RunningCommand> m_running;
 
   public:
     explicit LLDBCommandLine(lldb::SBDebugger& debugger);
+    ~LLDBCommandLine();
+
+    LLDBCommandLine(const LLDBCommandLine&) = delete;
+    LLDBCommandLine(LLDBCommandLine&&) = delete;
+    LLDBCommandLine& operator=(const LLDBCommandLine&) = delete;
+    LLDBCommandLine& operator=(LLDBCommandLine&&) = delete;
 
     lldb::SBCommandReturnObject run_command(const char* command, bool hide_from_history = false);
     std::optional<std::string> expand_and_unalias_command(const char* command);
 
-    // TODO: for_each_history_entry
-    [[nodiscard]] const std::vector<CommandLineEntry>& get_history() const
+    // Runs 'command' in the background, streaming its output into the
+    // history. No other lldb calls may be made until 'poll' returns its
+    // result, since lldb holds its API locks for the duration of the command.
+    bool start_command(const char* command);
+
+    // Moves the output produced since the last call into the history, and
+    // returns the command's result once it has finished.
+    std::optional<lldb::SBCommandReturnObject> poll();
+
+    // Asks lldb to stop the running command. Long-running commands (e.g.
+    // 'bt all', 'image dump symtab') check for this as they go.
+    void interrupt();
+
+    // Interrupts the running command, if any, and waits for it to finish.
+    void shutdown();
+
+    [[nodiscard]] bool is_running() const
+    {
+        return m_running != nullptr;
+    }
+
+    [[nodiscard]] const std::string& running_command() const
+    {
+        return m_running->command;
+    }
+
+    [[nodiscard]] const ConsoleHistory& get_history() const
+    {
+        return m_history;
+    }
+
+    ConsoleHistory& get_history()
     {
         return m_history;
     }
@@ -0,0 +1,195 @@
+#include "Locals.hpp"
+
+#include "Log.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+static void append_lowercase(std::string& out, const std::string& s)
+{
+    for (const char c : s)
+    {
+        out.push_back(char(std::tolower(static_cast<unsigned char>(c))));
+    }
+}
+
+uint32_t LocalsTree::add_node(lldb::SBValue value, uint32_t parent)
+{
+    const char* name = value.GetName();
+    const char* type = value.GetDisplayTypeName();
+    const char* value_text = value.GetValue();
+
+    LocalNode node;
+    node.id = value.GetID();
+    node.name = name != nullptr ? std::string(name) : std::string();
+    node.type = type != nullptr ? std::string(type) : std::string();
+    node.value_text = value_text != nullptr ? std::string(value_text) : std::string();
+    node.parent = parent;
+    node.might_have_children = value.MightHaveChildren();
+    node.value = value;
+
+    node.search_text.reserve(node.name.size() + node.type.size() + node.value_text.size() + 2);
+    append_lowercase(node.search_text, node.name);
+    node.search_text.push_back('\n');
+    append_lowercase(node.search_text, node.type);
+    node.search_text.push_back('\n');
+    append_lowercase(node.search_text, node.value_text);
+
+    const auto index = uint32_t(m_nodes.size());
+    m_nodes.emplace_back(std::move(node));
+    m_is_match.push_back(0);
+    m_has_matching_descendant.push_back(0);
+
+    if (!m_query.empty() && m_nodes[index].search_text.find(m_query) != std::string::npos)
+    {
+        m_matches.push_back(index);
+        mark_match(index);
+    }
+
+    return index;
+}
+
+void LocalsTree::mark_match(uint32_t node)
+{
+    m_is_match[node] = 1;
+
+    // stop early once an ancestor is already marked, its own ancestors are too
+    for (uint32_t parent = m_nodes[node].parent;
+         parent != NO_PARENT && m_has_matching_descendant[parent] == 0;
+         parent = m_nodes[parent].parent)
+    {
+        m_has_matching_descendant[parent] = 1;
+    }
+}
+
+void LocalsTree::rebuild_matches(const std::vector<uint32_t>& candidates)
+{
+    std::vector<uint32_t> matches;
+    for (const uint32_t candidate : candidates)
+    {
+        if (m_nodes[candidate].search_text.find(m_query) != std::string::npos)
+        {
+            matches.push_back(candidate);
+        }
+    }
+
+    std::fill(m_is_match.begin(), m_is_match.end(), 0);
+    std::fill(m_has_matching_descendant.begin(), m_has_matching_descendant.end(), 0);
+
+    m_matches = std::move(matches);
+    for (const uint32_t match : m_matches)
+    {
+        mark_match(match);
+    }
+}
+
+void LocalsTree::synchronize(
+    lldb::SBProcess& process, lldb::SBThread& thread, uint32_t frame_index
+)
+{
+    const uint32_t stop_id = process.GetStopID();
+    const lldb::tid_t thread_id = thread.GetThreadID();
+
+    if (m_process.IsValid() && process.GetUniqueID() == m_process.GetUniqueID() &&
+        stop_id == m_stop_id && thread_id == m_thread_id && frame_index == m_frame_index)
+    {
+        return;
+    }
+
+    m_process = process;
+    m_stop_id = stop_id;
+    m_thread_id = thread_id;
+    m_frame_index = frame_index;
+
+    m_nodes.clear();
+    m_roots.clear();
+    m_matches.clear();
+    m_is_match.clear();
+    m_has_matching_descendant.clear();
+
+    lldb::SBFrame frame = thread.GetFrameAtIndex(frame_index);
+    lldb::SBValueList locals = frame.GetVariables(true, true, true, true);
+
+    const uint32_t nlocals = locals.GetSize();
+    m_roots.reserve(nlocals);
+    for (uint32_t i = 0; i < nlocals; i++)
+    {
+        lldb::SBValue local = locals.GetValueAtIndex(i);
+        if (local.GetDisplayTypeName() == nullptr || local.GetName() == nullptr)
+        {
+            continue;
+        }
+        m_roots.push_back(add_node(local, NO_PARENT));
+    }
+
+    LOG(Verbose) << "Cached " << m_roots.size() << " locals for frame " << frame_index;
+}
+
+void LocalsTree::fetch_children(uint32_t node, uint32_t max_children)
+{
+    if (m_nodes[node].children_fetched)
+    {
+        return;
+    }
+
+    // NOTE: don't hold a reference into m_nodes here, adding nodes reallocates it
+    lldb::SBValue value = m_nodes[node].value;
+    const uint32_t nchildren = value.GetNumChildren(max_children);
+
+    std::vector<uint32_t> children;
+    children.reserve(nchildren);
+    for (uint32_t i = 0; i < nchildren; i++)
+    {
+        lldb::SBValue child = value.GetChildAtIndex(i);
+        if (child.GetDisplayTypeName() == nullptr || child.GetName() == nullptr)
+        {
+            continue;
+        }
+        children.push_back(add_node(child, node));
+    }
+
+    m_nodes[node].children = std::move(children);
+    m_nodes[node].children_fetched = true;
+}
+
+void LocalsTree::set_filter(std::string_view query)
+{
+    std::string lowered;
+    lowered.reserve(query.size());
+    for (const char c : query)
+    {
+        lowered.push_back(char(std::tolower(static_cast<unsigned char>(c))));
+    }
+
+    if (lowered == m_query)
+    {
+        return;
+    }
+
+    const bool narrowing = !m_query.empty() && lowered.size() > m_query.size() &&
+                           lowered.find(m_query) != std::string::npos;
+
+    m_query = std::move(lowered);
+
+    if (m_query.empty())
+    {
+        m_matches.clear();
+        std::fill(m_is_match.begin(), m_is_match.end(), 0);
+        std::fill(m_has_matching_descendant.begin(), m_has_matching_descendant.end(), 0);
+    }
+    else if (narrowing)
+    {
+        // anything containing the new query also contains the old one
+        const std::vector<uint32_t> candidates = m_matches;
+        rebuild_matches(candidates);
+    }
+    else
+    {
+        std::vector<uint32_t> candidates(m_nodes.size());
+        for (uint32_t i = 0; i < uint32_t(m_nodes.size()); i++)
+        {
+            candidates[i] = i;
+        }
+        rebuild_matches(candidates);
+    }
+}
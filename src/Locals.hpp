@@ -0,0 +1,96 @@
+#pragma once
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A local variable (or one of its children), with everything needed for
+// display and filtering copied out of lldb when the node is created.
+struct LocalNode
+{
+    lldb::SBValue value;
+    lldb::user_id_t id;
+    std::string name;
+    std::string type;
+    std::string value_text; // empty if lldb has no value to show
+    std::string search_text; // lowercased name, type and value
+    uint32_t parent;
+    bool might_have_children;
+    bool children_fetched = false;
+    std::vector<uint32_t> children;
+};
+
+// Per-stop cache of the locals tree for the viewed frame.
+//
+// The top level variables are read once per (stop id, thread, frame), and
+// children are only fetched from lldb the first time their parent is
+// expanded. Filtering only ever looks at the cached nodes:
+//   - if the new query extends the previous one, only the previous matches can
+//     still match, so only those are re-tested
+//   - newly fetched children are tested as they are added
+//   - anything else (e.g. deleting characters) re-tests the cached nodes,
+//     which never touches lldb
+class LocalsTree
+{
+    static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+    std::vector<LocalNode> m_nodes;
+    std::vector<uint32_t> m_roots;
+
+    lldb::SBProcess m_process;
+    uint32_t m_stop_id = 0;
+    lldb::tid_t m_thread_id = LLDB_INVALID_THREAD_ID;
+    uint32_t m_frame_index = 0;
+
+    std::string m_query; // lowercased
+    std::vector<uint32_t> m_matches; // node indices
+    std::vector<uint8_t> m_is_match;
+    std::vector<uint8_t> m_has_matching_descendant;
+
+    uint32_t add_node(lldb::SBValue value, uint32_t parent);
+    void mark_match(uint32_t node);
+    void rebuild_matches(const std::vector<uint32_t>& candidates);
+
+  public:
+    // Re-reads the top level locals if the process stopped again or a
+    // different thread or frame is viewed, keeping the current filter.
+    void synchronize(lldb::SBProcess& process, lldb::SBThread& thread, uint32_t frame_index);
+
+    // Fetches (at most 'max_children') children of the node from lldb, once.
+    void fetch_children(uint32_t node, uint32_t max_children);
+
+    void set_filter(std::string_view query);
+
+    [[nodiscard]] bool filter_active() const
+    {
+        return !m_query.empty();
+    }
+
+    [[nodiscard]] bool is_match(uint32_t node) const
+    {
+        return m_is_match[node] != 0;
+    }
+
+    [[nodiscard]] bool has_matching_descendant(uint32_t node) const
+    {
+        return m_has_matching_descendant[node] != 0;
+    }
+
+    [[nodiscard]] size_t match_count() const
+    {
+        return m_matches.size();
+    }
+
+    [[nodiscard]] const std::vector<uint32_t>& roots() const
+    {
+        return m_roots;
+    }
+
+    [[nodiscard]] LocalNode& node(uint32_t index)
+    {
+        return m_nodes[index];
+    }
+};
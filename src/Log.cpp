@@ -1,4 +1,502 @@
 #include "Log.hpp"
 
-std::unique_ptr<Logger> Logger::s_instance;
-std::mutex Logger::s_mutex;
+#include "LogSink.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <string_view>
+
+const char* log_level_name(LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::Debug:
+        return "DEBUG";
+    case LogLevel::Verbose:
+        return "VERBOSE";
+    case LogLevel::Info:
+        return "INFO";
+    case LogLevel::Warning:
+        return "WARNING";
+    case LogLevel::Error:
+        return "ERROR";
+    }
+    return "?";
+}
+
+const char* log_category_name(LogCategory category)
+{
+    switch (category)
+    {
+    case LogCategory::General:
+        return "general";
+    case LogCategory::Ui:
+        return "ui";
+    case LogCategory::Lldb:
+        return "lldb";
+    case LogCategory::LldbEvent:
+        return "lldb-event";
+    case LogCategory::IO:
+        return "io";
+    }
+    return "?";
+}
+
+void format_log_message(std::string& out, const LogMessage& message)
+{
+    fmt::format_to(
+        std::back_inserter(out), "{:>12.6f} T{:<3} [{}] [{}] ",
+        double(message.timestamp_ns) / 1e9, message.thread_id, log_level_name(message.level),
+        log_category_name(message.category)
+    );
+
+    if (message.file != nullptr)
+    {
+        const char* basename = message.file;
+        for (const char* c = message.file; *c != '\0'; c++)
+        {
+            if (*c == '/' || *c == '\\')
+            {
+                basename = c + 1;
+            }
+        }
+        fmt::format_to(std::back_inserter(out), "{}:{} ", basename, message.line);
+    }
+
+    out += message.message;
+}
+
+// Small sequential ids are easier to follow in a log than OS thread ids.
+static uint32_t current_thread_id()
+{
+    static std::atomic<uint32_t> s_next_id = 1;
+    thread_local const uint32_t id = s_next_id.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+Logger::Logger() : m_ring(std::make_unique<Slot[]>(RING_CAPACITY))
+{
+    for (size_t i = 0; i < RING_CAPACITY; i++)
+    {
+        m_ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+Logger::~Logger()
+{
+    shutdown();
+}
+
+uint64_t Logger::elapsed_ns() const
+{
+    const auto elapsed = std::chrono::steady_clock::now() - m_epoch;
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+bool Logger::log(LogMessage message)
+{
+    message.timestamp_ns = elapsed_ns();
+    message.thread_id = current_thread_id();
+
+    uint64_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+
+    for (;;)
+    {
+        slot = &m_ring[pos & (RING_CAPACITY - 1)];
+        const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const auto diff = int64_t(sequence) - int64_t(pos);
+
+        if (diff == 0)
+        {
+            // the slot is free, try to claim it
+            if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // the slot still holds a message from one lap ago: the ring is full
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            // another producer claimed this slot first
+            pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->record = std::move(message);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+void Logger::drain()
+{
+    for (;;)
+    {
+        Slot& slot = m_ring[m_dequeue_pos & (RING_CAPACITY - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != m_dequeue_pos + 1)
+        {
+            break; // empty, or the next message is still being written
+        }
+
+        m_repeats.filter(std::move(slot.record), m_filtered);
+        slot.record.message = std::string();
+
+        slot.sequence.store(m_dequeue_pos + RING_CAPACITY, std::memory_order_release);
+        m_dequeue_pos++;
+    }
+
+    const uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+    if (dropped > m_reported_dropped)
+    {
+        LogMessage overflow;
+        overflow.timestamp_ns = elapsed_ns();
+        overflow.thread_id = current_thread_id();
+        overflow.level = LogLevel::Warning;
+        overflow.message = "Log buffer overflowed, dropped " +
+                           std::to_string(dropped - m_reported_dropped) + " messages\n";
+        m_reported_dropped = dropped;
+
+        m_filtered.push_back(std::move(overflow));
+    }
+
+    m_repeats.expire(elapsed_ns(), m_filtered);
+    if (m_filtered.empty())
+    {
+        return;
+    }
+
+    // the writer reads the moved messages in place, from the chunks they landed in
+    const bool write = !m_sinks.empty();
+    std::vector<PendingRange> ranges;
+    for (LogMessage& message : m_filtered)
+    {
+        const size_t index = m_message_count % CHUNK_SIZE;
+        if (index == 0)
+        {
+            m_chunks.emplace_back(new LogMessage[CHUNK_SIZE]);
+        }
+        m_chunks.back()[index] = std::move(message);
+        m_message_count++;
+
+        if (!write)
+        {
+            continue;
+        }
+        if (ranges.empty() || ranges.back().chunk != m_chunks.back())
+        {
+            ranges.push_back({m_chunks.back(), (uint32_t) index, (uint32_t) index});
+        }
+        ranges.back().end++;
+    }
+    m_filtered.clear();
+
+    if (!ranges.empty())
+    {
+        std::unique_lock<std::mutex> lock(m_writer_mutex);
+        for (PendingRange& range : ranges)
+        {
+            // extend the last range not picked up yet, if this one follows it
+            PendingRange* last = m_pending.empty() ? nullptr : &m_pending.back();
+            if (last && last->chunk == range.chunk && last->end == range.begin)
+            {
+                last->end = range.end;
+            }
+            else
+            {
+                m_pending.push_back(std::move(range));
+            }
+        }
+        m_writer_cv.notify_one();
+    }
+}
+
+void Logger::add_sink(std::unique_ptr<LogSink> sink)
+{
+    // the writer thread iterates the sinks without a lock
+    if (m_writer.joinable())
+    {
+        LOG(Warning) << "Log sinks must be added before the writer thread starts, ignoring one";
+        return;
+    }
+
+    m_sinks.push_back(std::move(sink));
+}
+
+void Logger::start_writer()
+{
+    if (m_sinks.empty() || m_writer.joinable())
+    {
+        return;
+    }
+
+    m_writer = std::thread([this]() { this->write_loop(); });
+}
+
+void Logger::shutdown()
+{
+    if (!m_writer.joinable())
+    {
+        return;
+    }
+
+    drain();
+    {
+        std::unique_lock<std::mutex> lock(m_writer_mutex);
+        m_writer_stop = true;
+    }
+    m_writer_cv.notify_one();
+    m_writer.join();
+}
+
+void Logger::write_loop()
+{
+    // large batches are written right away by the sinks, small ones at least this often
+    static constexpr auto flush_interval = std::chrono::milliseconds(250);
+
+    std::vector<PendingRange> batch;
+    std::string text;
+    auto last_flush = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(m_writer_mutex);
+    for (;;)
+    {
+        m_writer_cv.wait_for(
+            lock, flush_interval, [this]() { return m_writer_stop || !m_pending.empty(); }
+        );
+        batch.swap(m_pending);
+        const bool stop = m_writer_stop;
+        lock.unlock();
+
+        text.clear();
+        for (const PendingRange& range : batch)
+        {
+            for (uint32_t i = range.begin; i < range.end; i++)
+            {
+                format_log_message(text, range.chunk[i]);
+            }
+        }
+        batch.clear();
+
+        const auto now = std::chrono::steady_clock::now();
+        const bool flush = stop || now - last_flush >= flush_interval;
+        for (const std::unique_ptr<LogSink>& sink : m_sinks)
+        {
+            if (!text.empty())
+            {
+                sink->write(text);
+            }
+            if (flush)
+            {
+                sink->flush();
+            }
+        }
+        if (flush)
+        {
+            last_flush = now;
+        }
+
+        if (stop)
+        {
+            return;
+        }
+        lock.lock();
+    }
+}
+
+void Logger::flush_on_crash()
+{
+    static std::atomic<bool> s_flushing = false;
+    if (m_sinks.empty() || s_flushing.exchange(true))
+    {
+        return;
+    }
+
+    std::string text;
+
+    // batches the writer thread hasn't picked up yet, unless it's holding the lock
+    if (m_writer_mutex.try_lock())
+    {
+        for (const PendingRange& range : m_pending)
+        {
+            for (uint32_t i = range.begin; i < range.end; i++)
+            {
+                format_log_message(text, range.chunk[i]);
+            }
+        }
+        m_pending.clear();
+        m_writer_mutex.unlock();
+    }
+
+    // and messages that haven't been drained from the ring yet
+    for (uint64_t pos = m_dequeue_pos;; pos++)
+    {
+        const Slot& slot = m_ring[pos & (RING_CAPACITY - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+        {
+            break;
+        }
+        format_log_message(text, slot.record);
+    }
+
+    for (const std::unique_ptr<LogSink>& sink : m_sinks)
+    {
+        sink->write_on_crash(text);
+    }
+}
+
+static void crash_signal_handler(int signal)
+{
+    Logger::get_instance()->flush_on_crash();
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+void Logger::install_crash_handler()
+{
+    for (const int signal : {SIGSEGV, SIGABRT, SIGFPE, SIGILL})
+    {
+        std::signal(signal, crash_signal_handler);
+    }
+#ifdef SIGBUS
+    std::signal(SIGBUS, crash_signal_handler);
+#endif
+}
+
+RepeatFilter::RepeatFilter()
+{
+    m_entries.reserve(CAPACITY);
+    m_by_hash.reserve(CAPACITY);
+}
+
+void RepeatFilter::unlink(uint32_t i)
+{
+    Entry& entry = m_entries[i];
+    (entry.prev != NONE ? m_entries[entry.prev].next : m_head) = entry.next;
+    (entry.next != NONE ? m_entries[entry.next].prev : m_tail) = entry.prev;
+}
+
+void RepeatFilter::push_front(uint32_t i)
+{
+    Entry& entry = m_entries[i];
+    entry.prev = NONE;
+    entry.next = m_head;
+    (m_head != NONE ? m_entries[m_head].prev : m_tail) = i;
+    m_head = i;
+}
+
+// Messages from different threads can reach the filter slightly out of order,
+// so a timestamp may be older than the window it falls into.
+static uint64_t elapsed_since(uint64_t start_ns, uint64_t now_ns)
+{
+    return now_ns > start_ns ? now_ns - start_ns : 0;
+}
+
+void RepeatFilter::summarize(Entry& entry, std::vector<LogMessage>& out)
+{
+    if (entry.seen > PASSED_PER_WINDOW)
+    {
+        LogMessage summary = entry.first;
+        summary.timestamp_ns = entry.last_seen_ns;
+        const uint64_t window_ns = elapsed_since(entry.window_start_ns, entry.last_seen_ns);
+        summary.message = fmt::format(
+            "[repeated {} times in {:.1f} s] {}\n", entry.seen - PASSED_PER_WINDOW,
+            double(window_ns) / 1e9, entry.first.message
+        );
+        out.push_back(std::move(summary));
+        m_pending_summaries--;
+    }
+    entry.seen = 0;
+}
+
+void RepeatFilter::filter(LogMessage message, std::vector<LogMessage>& out)
+{
+    const uint64_t hash = std::hash<std::string_view>{}(message.message);
+    const uint64_t now_ns = message.timestamp_ns;
+
+    uint32_t i = NONE;
+    if (auto it = m_by_hash.find(hash); it != m_by_hash.end())
+    {
+        i = it->second;
+        unlink(i);
+    }
+    else
+    {
+        if (m_entries.size() < CAPACITY)
+        {
+            i = uint32_t(m_entries.size());
+            m_entries.emplace_back();
+        }
+        else
+        {
+            // reuse the least recently seen entry
+            i = m_tail;
+            unlink(i);
+            summarize(m_entries[i], out);
+            m_by_hash.erase(m_entries[i].hash);
+        }
+        m_entries[i].hash = hash;
+        m_entries[i].window_start_ns = now_ns;
+        m_entries[i].seen = 0;
+        m_by_hash.emplace(hash, i);
+    }
+    push_front(i);
+
+    Entry& entry = m_entries[i];
+    if (elapsed_since(entry.window_start_ns, now_ns) >= WINDOW_NS)
+    {
+        summarize(entry, out);
+        entry.window_start_ns = now_ns;
+    }
+
+    if (entry.seen == 0)
+    {
+        // only keep what a summary needs, not the whole message
+        entry.first = message;
+        std::string& text = entry.first.message;
+        const size_t end = std::min({text.find('\n'), text.size(), size_t(120)});
+        const bool cut = end + 1 < text.size() || (end < text.size() && text[end] != '\n');
+        text.resize(end);
+        if (cut)
+        {
+            text += "...";
+        }
+    }
+
+    entry.seen++;
+    entry.last_seen_ns = now_ns;
+
+    if (entry.seen <= PASSED_PER_WINDOW)
+    {
+        out.push_back(std::move(message));
+    }
+    else if (entry.seen == PASSED_PER_WINDOW + 1)
+    {
+        m_pending_summaries++;
+    }
+}
+
+void RepeatFilter::expire(uint64_t now_ns, std::vector<LogMessage>& out)
+{
+    if (m_pending_summaries == 0)
+    {
+        return;
+    }
+
+    for (Entry& entry : m_entries)
+    {
+        if (entry.seen > PASSED_PER_WINDOW &&
+            elapsed_since(entry.window_start_ns, now_ns) >= WINDOW_NS)
+        {
+            summarize(entry, out);
+        }
+    }
+}
@@ -1,14 +1,35 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <sstream>
+#include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
-// TODO: modify to include file/function/line information?
-// also include lldb version/commit number?
-#define LOG(LEV) LogMessageStream(LogLevel::LEV)
+// The least severe level compiled in, set through CMake's LLDBG_LOG_LEVEL.
+// LOG sites below it are dead code the compiler drops.
+#ifndef LLDBG_LOG_LEVEL
+#define LLDBG_LOG_LEVEL Debug
+#endif
+
+// TODO: also include lldb version/commit number?
+//
+// The level is checked before the stream is even constructed, so the streamed
+// arguments of a disabled LOG are never evaluated. The source location is
+// captured as pointers to the compiler's static strings.
+#define LOG_CAT(LEV, CAT)                                                                          \
+    !log_enabled(LogLevel::LEV)                                                                    \
+        ? (void) 0                                                                                 \
+        : LogVoidify() &                                                                           \
+              LogMessageStream(LogLevel::LEV, LogCategory::CAT, __FILE__, __LINE__, __func__)
+
+#define LOG(LEV) LOG_CAT(LEV, General)
 
 enum class LogLevel : std::uint8_t
 {
@@ -19,93 +40,220 @@ enum class LogLevel : std::uint8_t
     Error = 0,
 };
 
+static constexpr LogLevel COMPILED_LOG_LEVEL = LogLevel::LLDBG_LOG_LEVEL;
+
+enum class LogCategory : std::uint8_t
+{
+    General,
+    Ui,
+    Lldb,      // commands run through the lldb command interpreter
+    LldbEvent, // events from lldb's listener
+    IO,
+};
+
+const char* log_level_name(LogLevel level);
+const char* log_category_name(LogCategory category);
+
+// A log record as captured. Everything but the message is fixed size, the text
+// form of the timestamp, location etc. is only produced when the record is
+// displayed or written out (see 'format_log_message').
 struct LogMessage
 {
-    const LogLevel level;
-    const std::string message;
+    uint64_t timestamp_ns = 0; // monotonic, since the logger was created
+    uint32_t thread_id = 0;    // sequential, in the order threads first log
+    uint32_t line = 0;
+    const char* file = nullptr; // static strings of the LOG site, null for the logger's own
+    const char* function = nullptr;
+    LogLevel level = LogLevel::Info;
+    LogCategory category = LogCategory::General;
+    std::string message;
+};
+
+// Appends "<seconds> T<thread> [<LEVEL>] [<category>] <file>:<line> <message>".
+void format_log_message(std::string& out, const LogMessage& message);
+
+class LogSink;
+
+// Suppresses bursts of identical messages. The first few repeats of a message
+// within a time window are let through, the rest are counted and summarized by
+// a single "[repeated N times in T s]" record once the window ends. Recent
+// messages are tracked in an LRU of fixed capacity (evicting an entry
+// summarizes it), so memory stays constant however long the session.
+class RepeatFilter
+{
+  public:
+    static constexpr size_t CAPACITY = 1024;
+    static constexpr uint64_t WINDOW_NS = 10000000000; // 10 s
+    static constexpr uint32_t PASSED_PER_WINDOW = 3;
+
+  private:
+    static constexpr uint32_t NONE = UINT32_MAX;
 
-    LogMessage(LogLevel level, std::string message) : level(level), message(std::move(message)) {}
+    struct Entry
+    {
+        uint64_t hash;
+        uint64_t window_start_ns;
+        uint64_t last_seen_ns;
+        uint32_t seen; // in the current window
+        uint32_t prev; // LRU list, most recently seen first
+        uint32_t next;
+        LogMessage first; // of the window, its message cut to one short line
+    };
+
+    std::vector<Entry> m_entries;
+    std::unordered_map<uint64_t, uint32_t> m_by_hash;
+    uint32_t m_head = NONE;
+    uint32_t m_tail = NONE;
+    uint32_t m_pending_summaries = 0; // entries with suppressed repeats
+
+    void unlink(uint32_t i);
+    void push_front(uint32_t i);
+    void summarize(Entry& entry, std::vector<LogMessage>& out);
+
+  public:
+    RepeatFilter();
+
+    // Appends what should be shown for 'message' to 'out': a summary of the
+    // previous window's repeats, if due, then the message unless it's suppressed.
+    void filter(LogMessage message, std::vector<LogMessage>& out);
+
+    // Appends summaries of windows that have ended by 'now_ns'.
+    void expire(uint64_t now_ns, std::vector<LogMessage>& out);
 };
 
+
+// Any thread may log without blocking: messages are pushed into a bounded
+// multi-producer single-consumer ring (Vyukov's bounded queue), and the UI
+// moves them into the message history once per frame with 'drain'. If the UI
+// falls behind and the ring fills up, further messages are dropped and counted
+// rather than stalling the thread that logged them.
+//
+// Each drained batch is also handed to a writer thread that feeds the sinks
+// (a log file, stderr), so the UI and lldb threads never wait on I/O. The
+// history is kept in fixed-size chunks that never move, so the writer is handed
+// ranges of them rather than copies: the UI only ever fills slots past those.
 class Logger
 {
-    std::vector<LogMessage> m_messages;
-    std::unordered_map<size_t, size_t> m_hashed_counts;
+    static constexpr size_t RING_CAPACITY = 4096; // must be a power of two
+    static constexpr size_t CHUNK_SIZE = 4096;    // messages per history chunk
+
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        LogMessage record;
+    };
+
+    // messages [begin, end) of a history chunk, to be written out
+    struct PendingRange
+    {
+        std::shared_ptr<const LogMessage[]> chunk;
+        uint32_t begin;
+        uint32_t end;
+    };
 
-    static std::unique_ptr<Logger> s_instance;
-    static std::mutex s_mutex;
+    std::unique_ptr<Slot[]> m_ring;
+    alignas(64) std::atomic<uint64_t> m_enqueue_pos = 0;
+    alignas(64) uint64_t m_dequeue_pos = 0;
+    std::atomic<uint64_t> m_dropped = 0;
+    std::atomic<int> m_log_level = (int) LogLevel::Debug;
+    const std::chrono::steady_clock::time_point m_epoch = std::chrono::steady_clock::now();
+
+    // only touched by the draining (UI) thread
+    std::vector<std::shared_ptr<LogMessage[]>> m_chunks;
+    size_t m_message_count = 0;
+    RepeatFilter m_repeats;
+    std::vector<LogMessage> m_filtered; // scratch for 'drain'
+    uint64_t m_reported_dropped = 0;
+
+    // the sinks are only touched by the writer thread (and by a crash)
+    std::vector<std::unique_ptr<LogSink>> m_sinks;
+    std::mutex m_writer_mutex; // guards m_pending and m_writer_stop
+    std::condition_variable m_writer_cv;
+    std::vector<PendingRange> m_pending;
+    bool m_writer_stop = false;
+    std::thread m_writer;
+
+    uint64_t elapsed_ns() const;
+    void write_loop();
 
   public:
+    Logger();
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger(Logger&&) = delete;
+    Logger& operator=(const Logger&) = delete;
+    Logger& operator=(Logger&&) = delete;
+
     static Logger* get_instance()
     {
-        std::unique_lock<std::mutex> lock(s_mutex);
-        if (!s_instance)
-        {
-            s_instance = std::make_unique<Logger>();
-        }
-        return s_instance.get();
+        static Logger s_instance;
+        return &s_instance;
     }
 
-    void log(LogLevel level, const std::string& message)
-    {
-        std::unique_lock<std::mutex> lock(s_mutex);
-        const size_t strhash = std::hash<std::string>{}(message);
-        auto it = m_hashed_counts.find(strhash);
+    // Stamps a record with the time and the calling thread and queues it,
+    // never blocks. Returns false if it had to be dropped.
+    bool log(LogMessage message);
 
-        if (it != m_hashed_counts.end())
-        {
-            if (it->second <= 3)
-            {
-                m_messages.emplace_back(level, message);
-                it->second++;
-            }
-            else if (it->second == 4)
-            {
-                m_messages.emplace_back(LogLevel::Info, "Silencing repeating message...");
-                it->second++;
-            }
-        }
-        else
-        {
-            m_hashed_counts.emplace(strhash, 1);
-            m_messages.emplace_back(level, message);
-        }
-    };
+    // Moves all queued messages into the history. Must only be called from one thread.
+    void drain();
+
+    // Sinks must all be added before 'start_writer', and before the first 'drain'.
+    void add_sink(std::unique_ptr<LogSink> sink);
+
+    // Starts the thread writing drained messages to the sinks, if there are any.
+    void start_writer();
+
+    // Drains what's left and waits for the writer thread to write it out.
+    void shutdown();
+
+    // Best effort attempt to write out everything not yet written, from a
+    // fatal signal handler. Not async-signal-safe, the process is going down
+    // anyway.
+    void flush_on_crash();
+
+    // Calls 'flush_on_crash' on SIGSEGV, SIGABRT and friends, then lets the signal kill us.
+    void install_crash_handler();
 
     void set_log_level(int level)
     {
-        std::unique_lock<std::mutex> lock(s_mutex);
-        m_log_level = level;
+        m_log_level.store(level, std::memory_order_relaxed);
     }
 
-    int get_log_level()
+    int get_log_level() const
     {
-        std::unique_lock<std::mutex> lock(s_mutex);
-        return m_log_level;
+        return m_log_level.load(std::memory_order_relaxed);
     }
 
-    template <typename MessageHandlerFunc> void for_each_message(MessageHandlerFunc&& f)
+    // The history as of the last 'drain', only to be read by the draining thread.
+    template <typename MessageHandlerFunc> void for_each_message(MessageHandlerFunc&& f) const
     {
-        std::unique_lock<std::mutex> lock(s_mutex);
-        for (const LogMessage& message : m_messages)
+        for (size_t i = 0; i < m_message_count; i++)
         {
-            f(message);
+            f(message(i));
         }
     }
 
-    inline size_t message_count()
+    inline size_t message_count() const
     {
-        std::unique_lock<std::mutex> lock(s_mutex);
-        return m_messages.size();
+        return m_message_count;
     }
 
-  private:
-    int m_log_level = (int) LogLevel::Debug;
+    [[nodiscard]] const LogMessage& message(size_t i) const
+    {
+        return m_chunks[i / CHUNK_SIZE][i % CHUNK_SIZE];
+    }
 };
 
+inline bool log_enabled(LogLevel level)
+{
+    return (int) level <= (int) COMPILED_LOG_LEVEL &&
+           (int) level <= Logger::get_instance()->get_log_level();
+}
+
 class LogMessageStream
 {
-    const LogLevel level;
+    LogMessage record;
     std::ostringstream oss;
 
   public:
@@ -115,15 +263,23 @@ class LogMessageStream
         return *this;
     }
 
-    explicit LogMessageStream(LogLevel level) : level(level) {}
+    LogMessageStream(
+        LogLevel level, LogCategory category, const char* file, uint32_t line, const char* function
+    )
+    {
+        record.level = level;
+        record.category = category;
+        record.file = file;
+        record.line = line;
+        record.function = function;
+    }
 
+    // the level has already been checked by LOG
     ~LogMessageStream()
     {
-        if (Logger::get_instance()->get_log_level() >= (int) level)
-        {
-            oss << '\n';
-            Logger::get_instance()->log(level, oss.str());
-        }
+        oss << '\n';
+        record.message = oss.str();
+        Logger::get_instance()->log(std::move(record));
     }
 
     LogMessageStream() = delete;
@@ -132,3 +288,10 @@ class LogMessageStream
     LogMessageStream& operator=(const LogMessageStream&) = delete;
     LogMessageStream& operator=(LogMessageStream&&) = delete;
 };
+
+// Turns 'LogMessageStream << ...' into a void expression, to match the other
+// branch of the conditional in LOG. '&' binds looser than '<<'.
+struct LogVoidify
+{
+    void operator&(const LogMessageStream&) const {}
+};
@@ -0,0 +1,106 @@
+#include "LogSink.hpp"
+
+#include <iostream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+void StderrSink::write(std::string_view text)
+{
+    std::fwrite(text.data(), 1, text.size(), stderr);
+}
+
+void StderrSink::flush()
+{
+    std::fflush(stderr);
+}
+
+FileSink::FileSink(fs::path path, uint64_t max_bytes, uint32_t max_files)
+    : m_path(std::move(path)), m_max_bytes(max_bytes), m_max_files(max_files)
+{
+    m_buffer.reserve(BUFFER_SIZE);
+    open();
+}
+
+FileSink::~FileSink()
+{
+    flush();
+    if (m_file != nullptr)
+    {
+        std::fclose(m_file);
+    }
+}
+
+void FileSink::open()
+{
+    // the sink does its own buffering, so every flush is a single write
+    m_file = std::fopen(m_path.string().c_str(), "ab");
+    if (m_file == nullptr)
+    {
+        // the logger can't report its own failures, stderr is all that's left
+        std::cerr << "Failed to open log file: " << m_path.string() << '\n';
+        return;
+    }
+    std::setvbuf(m_file, nullptr, _IONBF, 0);
+
+    std::error_code ec;
+    const uintmax_t size = fs::file_size(m_path, ec);
+    m_size = ec ? 0 : uint64_t(size);
+}
+
+void FileSink::rotate()
+{
+    std::fclose(m_file);
+    m_file = nullptr;
+
+    auto rotated = [this](uint32_t i)
+    {
+        fs::path path = m_path;
+        path += "." + std::to_string(i);
+        return path;
+    };
+
+    std::error_code ec;
+    if (m_max_files == 0)
+    {
+        fs::remove(m_path, ec);
+    }
+    else
+    {
+        fs::remove(rotated(m_max_files), ec);
+        for (uint32_t i = m_max_files - 1; i >= 1; i--)
+        {
+            fs::rename(rotated(i), rotated(i + 1), ec);
+        }
+        fs::rename(m_path, rotated(1), ec);
+    }
+
+    open();
+}
+
+void FileSink::write(std::string_view text)
+{
+    m_buffer.append(text);
+    if (m_buffer.size() >= BUFFER_SIZE)
+    {
+        flush();
+    }
+}
+
+void FileSink::flush()
+{
+    if (m_file == nullptr || m_buffer.empty())
+    {
+        m_buffer.clear();
+        return;
+    }
+
+    std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+    m_size += m_buffer.size();
+    m_buffer.clear();
+
+    if (m_max_bytes > 0 && m_size >= m_max_bytes)
+    {
+        rotate();
+    }
+}
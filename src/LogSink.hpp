@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// A destination for formatted log text, fed in batches by the Logger's writer thread.
+class LogSink
+{
+  public:
+    virtual ~LogSink() = default;
+
+    // May buffer, the text is only guaranteed to be written after 'flush'.
+    virtual void write(std::string_view text) = 0;
+    virtual void flush() = 0;
+
+    // Writes out anything buffered followed by 'text', right away.
+    virtual void write_on_crash(std::string_view text)
+    {
+        write(text);
+        flush();
+    }
+};
+
+class StderrSink final : public LogSink
+{
+  public:
+    void write(std::string_view text) override;
+    void flush() override;
+};
+
+// Appends to a log file, collecting writes into one large buffer. Once the
+// file reaches 'max_bytes' it is rotated: 'log' becomes 'log.1', 'log.1'
+// becomes 'log.2' and so on, keeping at most 'max_files' old logs.
+class FileSink final : public LogSink
+{
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    std::filesystem::path m_path;
+    uint64_t m_max_bytes;
+    uint32_t m_max_files;
+
+    std::FILE* m_file = nullptr;
+    uint64_t m_size = 0; // of the current file
+    std::string m_buffer;
+
+    void open();
+    void rotate();
+
+  public:
+    FileSink(std::filesystem::path path, uint64_t max_bytes, uint32_t max_files);
+    ~FileSink() override;
+
+    FileSink(const FileSink&) = delete;
+    FileSink(FileSink&&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+    FileSink& operator=(FileSink&&) = delete;
+
+    [[nodiscard]] bool is_open() const
+    {
+        return m_file != nullptr;
+    }
+
+    void write(std::string_view text) override;
+    void flush() override;
+};
@@ -0,0 +1,410 @@
+#include "LogView.hpp"
+
+#include "StringBuffer.hpp"
+#include "Timer.hpp"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <utility>
+
+static std::pair<ImVec4, const char*> level_label(LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::Verbose:
+        return {ImVec4(78.f / 255.f, 78.f / 255.f, 78.f / 255.f, 255.f), "[VERBOSE]"};
+    case LogLevel::Debug:
+        return {ImVec4(52.f / 255.f, 56.f / 255.f, 176.f / 255.f, 255.f / 255.f), "[DEBUG]"};
+    case LogLevel::Info:
+        return {ImVec4(225.f / 255.f, 225.f / 255.f, 225.f / 255.f, 255.f / 255.f), "[INFO]"};
+    case LogLevel::Warning:
+        return {ImVec4(216.f / 255.f, 129.f / 255.f, 42.f / 255.f, 255.f / 255.f), "[WARNING]"};
+    case LogLevel::Error:
+        return {ImVec4(212.f / 255.f, 67.f / 255.f, 67.f / 255.f, 255.f / 255.f), "[ERROR]"};
+    }
+    return {ImVec4(1.f, 1.f, 1.f, 1.f), "[?]"};
+}
+
+static size_t level_index(LogLevel level)
+{
+    return size_t(level) / 20; // Error = 0 ... Debug = 4
+}
+
+// Indexes messages that arrived since the last frame.
+void LogView::index_new_messages()
+{
+    Logger* logger = Logger::get_instance();
+    const size_t count = logger->message_count();
+
+    if (count < m_indexed)
+    {
+        // the history was cleared
+        for (std::vector<uint32_t>& list : m_by_level)
+        {
+            list.clear();
+        }
+        for (std::vector<uint32_t>& list : m_by_category)
+        {
+            list.clear();
+        }
+        m_layouts.clear();
+        m_indexed = 0;
+        restart_search();
+    }
+
+    for (size_t i = m_indexed; i < count; i++)
+    {
+        const LogMessage& message = logger->message(i);
+        m_by_level[level_index(message.level)].push_back(uint32_t(i));
+        m_by_category[size_t(message.category)].push_back(uint32_t(i));
+    }
+    m_indexed = count;
+    m_layouts.resize(count);
+}
+
+void LogView::restart_search()
+{
+    m_visible.clear();
+    m_offsets.assign(1, 0.f);
+    m_level_cursors.fill(0);
+    m_category_cursor = 0;
+    m_scan_complete = false;
+    m_relayout_cursor = 0;
+}
+
+bool LogView::matches(const LogMessage& message) const
+{
+    if (level_index(message.level) > size_t(m_max_level))
+    {
+        return false;
+    }
+
+    if (m_category >= 0 && size_t(message.category) != size_t(m_category))
+    {
+        return false;
+    }
+
+    if (m_regex.has_value())
+    {
+        return std::regex_search(message.message, *m_regex);
+    }
+
+    if (!m_active_search.empty())
+    {
+        // case-insensitive substring search, m_active_search is lower case
+        const auto it = std::search(
+            message.message.begin(), message.message.end(), m_active_search.begin(),
+            m_active_search.end(),
+            [](char a, char b) { return std::tolower((unsigned char) a) == b; }
+        );
+        return it != message.message.end();
+    }
+
+    return true;
+}
+
+float LogView::measure(uint32_t i)
+{
+    MessageLayout& layout = m_layouts[i];
+    if (layout.height >= 0.f && layout.wrap_width == m_wrap_width)
+    {
+        return layout.height;
+    }
+
+    const std::string& message = Logger::get_instance()->message(i).message;
+    const char* begin = message.data();
+    const char* end = begin + message.size();
+
+    if (layout.natural_width < 0.f)
+    {
+        // the trailing newline every message ends with doesn't start a new line
+        const char* newline = std::find(begin, end, '\n');
+        const bool multiline = newline != end && newline + 1 != end;
+        layout.natural_width = multiline ? 0.f : ImGui::CalcTextSize(begin, end).x;
+    }
+
+    const float line_height = ImGui::GetTextLineHeight();
+    const float height = layout.natural_width > 0.f && layout.natural_width <= m_wrap_width
+                             ? line_height
+                             : ImGui::CalcTextSize(begin, end, false, m_wrap_width).y;
+    layout.height = std::max(height, line_height) + ImGui::GetStyle().ItemSpacing.y;
+    layout.wrap_width = m_wrap_width;
+    return layout.height;
+}
+
+// The height last measured, at whatever width, or a single line if never measured.
+float LogView::cached_height(uint32_t i) const
+{
+    const float height = m_layouts[i].height;
+    return height >= 0.f ? height : ImGui::GetTextLineHeight() + ImGui::GetStyle().ItemSpacing.y;
+}
+
+// Re-measures the matches overlapping [top, bottom) right away, and the others
+// in order until the time budget is spent, then re-accumulates the offsets from
+// the first one that may have changed.
+void LogView::relayout(float top, float bottom, uint64_t budget_ns)
+{
+    if (m_relayout_cursor >= m_visible.size())
+    {
+        return;
+    }
+
+    const auto after_top = std::upper_bound(m_offsets.begin(), m_offsets.end(), top);
+    size_t row = after_top != m_offsets.begin() ? size_t(after_top - m_offsets.begin()) - 1 : 0;
+    const size_t first_changed = std::min(row, m_relayout_cursor);
+    for (; row < m_visible.size() && m_offsets[row] < bottom; row++)
+    {
+        measure(m_visible[row]);
+    }
+
+    Timer timer;
+    while (m_relayout_cursor < m_visible.size())
+    {
+        measure(m_visible[m_relayout_cursor++]);
+        if ((m_relayout_cursor & 255) == 0 && timer.elapsed_ns() > budget_ns)
+        {
+            break;
+        }
+    }
+
+    for (size_t k = first_changed; k < m_visible.size(); k++)
+    {
+        m_offsets[k + 1] = m_offsets[k] + cached_height(m_visible[k]);
+    }
+}
+
+void LogView::add_match(uint32_t i)
+{
+    m_visible.push_back(i);
+    m_offsets.push_back(m_offsets.back() + measure(i));
+}
+
+// Continues collecting matches, in message order, until the posting lists are
+// exhausted or the time budget is spent.
+void LogView::scan(uint64_t budget_ns)
+{
+    Logger* logger = Logger::get_instance();
+    Timer timer;
+    size_t steps = 0;
+    auto out_of_time = [&]() { return (++steps & 1023) == 0 && timer.elapsed_ns() > budget_ns; };
+
+    m_scan_complete = false;
+
+    if (m_category >= 0)
+    {
+        const std::vector<uint32_t>& list = m_by_category[size_t(m_category)];
+        while (m_category_cursor < list.size())
+        {
+            const uint32_t i = list[m_category_cursor++];
+            if (matches(logger->message(i)))
+            {
+                add_match(i);
+            }
+            if (out_of_time())
+            {
+                return;
+            }
+        }
+    }
+    else
+    {
+        // merge the lists of the levels shown
+        for (;;)
+        {
+            size_t from = NLEVELS;
+            for (size_t l = 0; l <= size_t(m_max_level); l++)
+            {
+                if (m_level_cursors[l] < m_by_level[l].size() &&
+                    (from == NLEVELS ||
+                     m_by_level[l][m_level_cursors[l]] < m_by_level[from][m_level_cursors[from]]))
+                {
+                    from = l;
+                }
+            }
+            if (from == NLEVELS)
+            {
+                break;
+            }
+
+            const uint32_t i = m_by_level[from][m_level_cursors[from]++];
+            if (matches(logger->message(i)))
+            {
+                add_match(i);
+            }
+            if (out_of_time())
+            {
+                return;
+            }
+        }
+    }
+
+    m_scan_complete = true;
+}
+
+void LogView::draw_filters()
+{
+    static constexpr const char* levels[] = {"errors", "warnings", "info", "verbose", "debug"};
+    static constexpr const char* categories[] = {"all",  "general",    "ui",
+                                                 "lldb", "lldb-event", "io"};
+    static_assert(std::size(levels) == NLEVELS && std::size(categories) == NCATEGORIES + 1);
+
+    bool changed = false;
+
+    ImGui::SetNextItemWidth(100.f);
+    changed |= ImGui::Combo("##LogLevel", &m_max_level, levels, int(NLEVELS));
+    ImGui::SameLine();
+
+    int category = m_category + 1;
+    ImGui::SetNextItemWidth(110.f);
+    if (ImGui::Combo("##LogCategory", &category, categories, int(NCATEGORIES + 1)))
+    {
+        m_category = category - 1;
+        changed = true;
+    }
+    ImGui::SameLine();
+
+    ImGui::SetNextItemWidth(250.f);
+    ImGui::InputTextWithHint("##LogSearch", "filter", m_search.data(), m_search.size());
+    ImGui::SameLine();
+    changed |= ImGui::Checkbox("regex", &m_use_regex);
+
+    // (re)compile the search only when its text or mode changes
+    std::string search = m_search.data();
+    if (!m_use_regex)
+    {
+        std::transform(
+            search.begin(), search.end(), search.begin(),
+            [](char c) { return char(std::tolower((unsigned char) c)); }
+        );
+    }
+    if (changed || search != m_active_search)
+    {
+        m_active_search = std::move(search);
+        m_regex.reset();
+        m_regex_error.clear();
+
+        if (m_use_regex && !m_active_search.empty())
+        {
+            try
+            {
+                m_regex.emplace(
+                    m_active_search, std::regex::ECMAScript | std::regex::icase |
+                                         std::regex::optimize
+                );
+            }
+            catch (const std::regex_error& e)
+            {
+                m_regex_error = e.what();
+            }
+        }
+        restart_search();
+    }
+
+    ImGui::SameLine();
+    StringBuffer status;
+    if (!m_regex_error.empty())
+    {
+        status.format("invalid regex: {}", m_regex_error);
+    }
+    else
+    {
+        status.format_(
+            "{} of {} messages", m_visible.size(), Logger::get_instance()->message_count()
+        );
+        if (!m_scan_complete)
+        {
+            status.format_(" (searching...)");
+        }
+        status.push_back('\0');
+    }
+    ImGui::TextUnformatted(status.data());
+}
+
+void LogView::render()
+{
+    static constexpr uint64_t scan_budget_ns = 4000000; // per frame
+
+    Logger* logger = Logger::get_instance();
+
+    index_new_messages();
+    draw_filters();
+
+    ImGui::BeginChild("LogEntries");
+
+    const float prefix_width = ImGui::CalcTextSize("[WARNING] ").x;
+    const float start_x = ImGui::GetCursorPosX();
+    const float start_y = ImGui::GetCursorPosY();
+    const float wrap_width = std::max(1.f, ImGui::GetContentRegionAvail().x - prefix_width);
+    const bool at_bottom = ImGui::GetScrollY() >= ImGui::GetScrollMaxY();
+    const size_t matches_before = m_visible.size();
+
+    // a font change (e.g. DPI scaling) invalidates the unwrapped widths too
+    if (prefix_width != m_prefix_width)
+    {
+        m_prefix_width = prefix_width;
+        m_layouts.assign(m_layouts.size(), MessageLayout());
+        m_relayout_cursor = 0;
+    }
+
+    if (wrap_width != m_wrap_width)
+    {
+        m_wrap_width = wrap_width;
+        m_relayout_cursor = 0;
+    }
+
+    // the matches overlapping [top, bottom), in content coordinates
+    const float top = ImGui::GetScrollY() - start_y;
+    const float bottom = top + ImGui::GetWindowHeight();
+
+    // laying out and searching share the frame's time budget
+    Timer timer;
+    const float height_before = m_offsets.back();
+    relayout(top, bottom, scan_budget_ns);
+    scan(scan_budget_ns - std::min(scan_budget_ns, timer.elapsed_ns()));
+
+    const auto after_top = std::upper_bound(m_offsets.begin(), m_offsets.end(), top);
+    size_t row = after_top != m_offsets.begin() ? size_t(after_top - m_offsets.begin()) - 1 : 0;
+
+    ImGui::PushTextWrapPos(0.f);
+    for (; row < m_visible.size() && m_offsets[row] < bottom; row++)
+    {
+        const LogMessage& entry = logger->message(m_visible[row]);
+        const auto [color, label] = level_label(entry.level);
+
+        ImGui::SetCursorPos(ImVec2(start_x, start_y + m_offsets[row]));
+        ImGui::TextColored(color, "%s", label);
+        ImGui::SameLine();
+        ImGui::SetCursorPosX(start_x + prefix_width);
+        ImGui::TextUnformatted(entry.message.data(), entry.message.data() + entry.message.size());
+
+        // the record's details are only formatted for the message under the mouse
+        if (ImGui::IsItemHovered())
+        {
+            std::string details;
+            format_log_message(details, entry);
+            if (entry.function != nullptr)
+            {
+                details += "in ";
+                details += entry.function;
+            }
+            ImGui::SetTooltip("%s", details.c_str());
+        }
+    }
+    ImGui::PopTextWrapPos();
+
+    // reserve the height of all matches, so the scrollbar covers the whole log
+    ImGui::SetCursorPos(ImVec2(start_x, start_y + m_offsets.back()));
+    ImGui::Dummy(ImVec2(0.f, 0.f));
+
+    // follow new messages (and the bottom through relayouts), unless the user
+    // scrolled up to read older ones
+    if ((m_visible.size() > matches_before || m_offsets.back() != height_before) && at_bottom)
+    {
+        ImGui::SetScrollY(start_y + m_offsets.back());
+    }
+
+    ImGui::EndChild();
+}
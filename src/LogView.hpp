@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Log.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <regex>
+#include <string>
+#include <vector>
+
+// The "log" tab: the message history, filtered by level, category and text,
+// drawing only the messages in view.
+//
+// Filtering: as messages arrive they are appended to a posting list for their
+// level and one for their category. A filter walks the lists it needs (merged
+// back into message order) instead of the whole history, so only the text
+// search ever looks at the messages themselves. Matches are collected under a
+// per-frame time budget, which means changing the filter on a million messages
+// never stalls a frame, and new messages are matched as they come in rather
+// than by re-scanning.
+//
+// Layout: wrapped messages have different heights, so ImGuiListClipper (which
+// assumes uniform rows) doesn't fit. Instead each message's height, wrapped to
+// the current width, is cached, along with a running sum of the heights of the
+// matching messages. The first visible row is found by binary search on that
+// sum. Heights are measured once, and again only when the wrap width changes;
+// messages that fit on one line (most of them) skip the wrapped measurement.
+// After a width change (e.g. every frame of a window resize) only the messages
+// in view are re-measured right away, the others under the same per-frame time
+// budget as the search, keeping their old heights until then.
+class LogView
+{
+    static constexpr size_t NLEVELS = 5;
+    static constexpr size_t NCATEGORIES = 5;
+
+    struct MessageLayout
+    {
+        // unwrapped, 0 if the message spans several lines, -1 until measured
+        float natural_width = -1.f;
+        float height = -1.f; // at 'wrap_width', with item spacing, -1 until measured
+        float wrap_width = -1.f;
+    };
+
+    std::vector<MessageLayout> m_layouts; // per message
+    float m_wrap_width = -1.f;
+    float m_prefix_width = -1.f;
+
+    // message indices, in order
+    std::array<std::vector<uint32_t>, NLEVELS> m_by_level;
+    std::array<std::vector<uint32_t>, NCATEGORIES> m_by_category;
+    size_t m_indexed = 0;
+
+    int m_max_level = int(NLEVELS) - 1; // 0 = errors only ... 4 = everything
+    int m_category = -1;                // -1 for all
+    std::array<char, 256> m_search = {};
+    bool m_use_regex = false;
+    std::string m_active_search;
+    std::optional<std::regex> m_regex;
+    std::string m_regex_error;
+
+    // the matches found so far, and how far the search has got
+    std::vector<uint32_t> m_visible;
+    std::vector<float> m_offsets = {0.f}; // top of match i, back() is the total height
+    std::array<size_t, NLEVELS> m_level_cursors = {};
+    size_t m_category_cursor = 0;
+    bool m_scan_complete = true;
+    size_t m_relayout_cursor = 0; // matches before it are measured at m_wrap_width
+
+    void index_new_messages();
+    void restart_search();
+    [[nodiscard]] bool matches(const LogMessage& message) const;
+    void add_match(uint32_t i);
+    void scan(uint64_t budget_ns);
+    float measure(uint32_t i);
+    [[nodiscard]] float cached_height(uint32_t i) const;
+    void relayout(float top, float bottom, uint64_t budget_ns);
+    void draw_filters();
+
+  public:
+    void render();
+};
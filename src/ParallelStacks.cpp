@@ -0,0 +1,265 @@
+#include "ParallelStacks.hpp"
+
+#include "Defer.hpp"
+#include "Log.hpp"
+#include "Symbolication.hpp"
+#include "Timer.hpp"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+// frames beyond this are not unwound, deep recursion would otherwise dominate
+static constexpr uint32_t MAX_UNWOUND_FRAMES = 256;
+
+static constexpr size_t THREADS_PER_TASK = 32;
+static constexpr size_t MAX_POOL_THREADS = 8;
+
+struct UnwoundThread
+{
+    StackThread thread;
+    std::vector<lldb::addr_t> pcs; // innermost frame first
+    uint64_t hash = 0;
+    bool valid = false;
+};
+
+// FNV-1a over the PC chain
+static uint64_t hash_pcs(const std::vector<lldb::addr_t>& pcs)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (const lldb::addr_t pc : pcs)
+    {
+        hash ^= pc;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static StackNode make_node(lldb::addr_t pc, uint32_t parent)
+{
+    StackNode node;
+    node.pc = pc;
+    node.parent = parent;
+    return node;
+}
+
+ParallelStacks::ParallelStacks()
+    : m_pool(std::min(MAX_POOL_THREADS, size_t(std::thread::hardware_concurrency())))
+{
+}
+
+ParallelStacks::~ParallelStacks()
+{
+    shutdown();
+}
+
+void ParallelStacks::shutdown()
+{
+    m_generation++;
+
+    if (m_collector.joinable())
+    {
+        m_collector.join();
+    }
+}
+
+std::shared_ptr<const StackGroups> ParallelStacks::groups()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_groups;
+}
+
+void ParallelStacks::request(lldb::SBProcess& process)
+{
+    const uint32_t stop_id = process.GetStopID();
+    const uint32_t process_id = process.GetUniqueID();
+
+    if (m_requested_stop_id == stop_id && m_requested_process_id == process_id)
+    {
+        return;
+    }
+
+    // A collection for an older stop is abandoned, its results would be stale.
+    // It stops at its next check, but that can be in the middle of a long
+    // unwind, so the new collector waits for it instead of the UI thread.
+    const uint64_t generation = ++m_generation;
+
+    m_requested_stop_id = stop_id;
+    m_requested_process_id = process_id;
+    m_collecting.store(true, std::memory_order_release);
+
+    m_collector = std::thread(
+        [this, process, generation, previous = std::move(m_collector)]() mutable
+        {
+            if (previous.joinable())
+            {
+                previous.join();
+            }
+            this->collect(process, generation);
+        }
+    );
+}
+
+void ParallelStacks::collect(lldb::SBProcess process, uint64_t generation)
+{
+    auto abandoned = [this, generation]() { return m_generation.load() != generation; };
+
+    // An abandoned collection leaves the flag to the one that replaced it, which
+    // sets it again in case this one was abandoned right after checking.
+    if (!abandoned())
+    {
+        m_collecting.store(true, std::memory_order_release);
+    }
+    Defer(if (!abandoned()) { m_collecting.store(false, std::memory_order_release); });
+
+    Timer timer;
+
+    const uint32_t nthreads = process.GetNumThreads();
+    std::vector<UnwoundThread> unwound(nthreads);
+
+    m_pool.parallel_for(
+        nthreads, THREADS_PER_TASK,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end && !abandoned(); i++)
+            {
+                lldb::SBThread th = process.GetThreadAtIndex(i);
+                if (!th.IsValid())
+                {
+                    continue;
+                }
+
+                UnwoundThread& u = unwound[i];
+                u.thread.index = uint32_t(i);
+                u.thread.index_id = th.GetIndexID();
+                u.thread.id = th.GetThreadID();
+
+                // GetFrameAtIndex only unwinds as far as it needs to, unlike GetNumFrames
+                for (uint32_t f = 0; f < MAX_UNWOUND_FRAMES; f++)
+                {
+                    lldb::SBFrame frame = th.GetFrameAtIndex(f);
+                    if (!frame.IsValid())
+                    {
+                        break;
+                    }
+                    u.pcs.push_back(frame.GetPC());
+                }
+
+                u.thread.truncated = th.GetFrameAtIndex(MAX_UNWOUND_FRAMES).IsValid();
+                u.hash = hash_pcs(u.pcs);
+                u.valid = true;
+            }
+        }
+    );
+
+    if (abandoned())
+    {
+        return;
+    }
+
+    auto groups = std::make_shared<StackGroups>();
+    groups->stop_id = process.GetStopID();
+    groups->process_id = process.GetUniqueID();
+    groups->nodes.push_back(make_node(LLDB_INVALID_ADDRESS, UINT32_MAX));
+
+    // group identical stacks by hash first, so that each unique stack is only
+    // inserted into the tree once
+    std::unordered_map<uint64_t, std::vector<size_t>> unique_by_hash;
+    std::vector<std::vector<size_t>> members; // per unique stack, indices into 'unwound'
+    std::vector<size_t> representatives;      // per unique stack, an index into 'unwound'
+
+    for (size_t i = 0; i < unwound.size(); i++)
+    {
+        if (!unwound[i].valid)
+        {
+            continue;
+        }
+
+        std::vector<size_t>& candidates = unique_by_hash[unwound[i].hash];
+        auto it = std::find_if(
+            candidates.begin(), candidates.end(),
+            [&](size_t u) { return unwound[representatives[u]].pcs == unwound[i].pcs; }
+        );
+
+        if (it != candidates.end())
+        {
+            members[*it].push_back(i);
+        }
+        else
+        {
+            candidates.push_back(representatives.size());
+            representatives.push_back(i);
+            members.push_back({i});
+        }
+    }
+
+    groups->unique_stacks = representatives.size();
+
+    std::map<std::pair<uint32_t, lldb::addr_t>, uint32_t> child_lookup;
+
+    for (size_t u = 0; u < representatives.size(); u++)
+    {
+        const std::vector<lldb::addr_t>& pcs = unwound[representatives[u]].pcs;
+        const auto count = uint32_t(members[u].size());
+
+        uint32_t node = StackGroups::ROOT;
+        groups->nodes[node].thread_count += count;
+
+        for (auto pc = pcs.rbegin(); pc != pcs.rend(); ++pc)
+        {
+            auto [it, inserted] =
+                child_lookup.try_emplace({node, *pc}, uint32_t(groups->nodes.size()));
+            if (inserted)
+            {
+                groups->nodes.push_back(make_node(*pc, node));
+                groups->nodes[node].children.push_back(it->second);
+            }
+            node = it->second;
+            groups->nodes[node].thread_count += count;
+        }
+
+        for (const size_t i : members[u])
+        {
+            groups->nodes[node].threads.push_back(uint32_t(groups->threads.size()));
+            groups->threads.push_back(unwound[i].thread);
+        }
+    }
+
+    // largest groups first
+    for (StackNode& node : groups->nodes)
+    {
+        std::sort(
+            node.children.begin(), node.children.end(),
+            [&groups](uint32_t a, uint32_t b)
+            { return groups->nodes[a].thread_count > groups->nodes[b].thread_count; }
+        );
+    }
+
+    // names are only resolved once per unique frame
+    lldb::SBTarget target = process.GetTarget();
+    m_pool.parallel_for(
+        groups->nodes.size(), 64,
+        [&](size_t begin, size_t end)
+        {
+            for (size_t i = std::max(begin, size_t(1)); i < end && !abandoned(); i++)
+            {
+                StackNode& node = groups->nodes[i];
+                node.function_name = resolve_function_name(target, node.pc);
+            }
+        }
+    );
+
+    if (abandoned())
+    {
+        return;
+    }
+
+    groups->elapsed_ns = timer.elapsed_ns();
+
+    LOG(Verbose) << "Grouped " << groups->threads.size() << " threads into "
+                 << groups->unique_stacks << " unique stacks in "
+                 << groups->elapsed_ns / 1000000 << " ms";
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_groups = std::move(groups);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StackThread
+{
+    uint32_t index; // position in the process' thread list, see SBProcess::GetThreadAtIndex
+    uint32_t index_id;
+    lldb::tid_t id;
+    bool truncated; // the stack was deeper than the unwinding cap
+};
+
+// One frame of the merged stack tree. The tree is rooted at the outermost
+// frames (e.g. 'start_thread'), so threads that share the bottom of their
+// stacks share a path from the root, and identical stacks end at the same node.
+struct StackNode
+{
+    lldb::addr_t pc;
+    uint32_t parent;
+    uint32_t thread_count = 0; // threads whose stack passes through this frame
+    std::string function_name;
+    std::vector<uint32_t> children;
+    std::vector<uint32_t> threads; // indices into StackGroups::threads whose top frame this is
+};
+
+struct StackGroups
+{
+    static constexpr uint32_t ROOT = 0; // a virtual node, not a real frame
+
+    uint32_t stop_id = 0;
+    uint32_t process_id = 0;
+    std::vector<StackNode> nodes;
+    std::vector<StackThread> threads;
+    size_t unique_stacks = 0;
+    uint64_t elapsed_ns = 0;
+};
+
+// Builds the "parallel stacks" view: every thread is unwound (up to a frame
+// cap) on a pool of workers, identical PC chains are grouped by hash, and the
+// unique chains are merged into a prefix tree.
+//
+// Collection runs in the background and publishes an immutable StackGroups
+// when done, so the UI never waits on it. A new stop discards any collection
+// still in flight.
+// NOTE: lldb serializes most SB calls on the target's API mutex, so unwinding
+// only scales so far; the pool mainly keeps the UI thread free while the
+// unwinding is done in many short calls.
+class ParallelStacks
+{
+    ThreadPool m_pool;
+
+    std::mutex m_mutex; // guards m_groups
+    std::shared_ptr<const StackGroups> m_groups;
+
+    std::optional<uint32_t> m_requested_stop_id = {};
+    std::optional<uint32_t> m_requested_process_id = {};
+    std::atomic<uint64_t> m_generation = 0;
+    std::atomic<bool> m_collecting = false;
+
+    std::thread m_collector;
+
+    void collect(lldb::SBProcess process, uint64_t generation);
+
+  public:
+    ParallelStacks();
+    ~ParallelStacks();
+
+    ParallelStacks(const ParallelStacks&) = delete;
+    ParallelStacks(ParallelStacks&&) = delete;
+    ParallelStacks& operator=(const ParallelStacks&) = delete;
+    ParallelStacks& operator=(ParallelStacks&&) = delete;
+
+    // Starts collecting the stacks of a stopped process, unless they are
+    // already collected (or being collected) for this stop.
+    void request(lldb::SBProcess& process);
+
+    // Discards any collection in flight and waits for the collector to finish.
+    void shutdown();
+
+    [[nodiscard]] std::shared_ptr<const StackGroups> groups();
+
+    [[nodiscard]] bool is_collecting() const
+    {
+        return m_collecting.load(std::memory_order_acquire);
+    }
+};
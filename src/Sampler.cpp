@@ -0,0 +1,309 @@
+#include "Sampler.hpp"
+
+#include "Defer.hpp"
+#include "Log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+// FNV-1a over the PC chain
+static uint64_t hash_pcs(const std::vector<lldb::addr_t>& pcs)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (const lldb::addr_t pc : pcs)
+    {
+        hash ^= pc;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// The threads that are on a CPU or waiting for one, as opposed to blocked.
+// Only Linux exposes this (through procfs), and only for local processes;
+// std::nullopt means every thread has to be sampled.
+static std::optional<std::unordered_set<lldb::tid_t>> find_running_threads(lldb::pid_t pid)
+{
+#ifdef __linux__
+    const std::string task_dir = "/proc/" + std::to_string(pid) + "/task";
+    std::error_code ec;
+    std::filesystem::directory_iterator it(task_dir, ec);
+    if (ec)
+    {
+        return {};
+    }
+
+    std::unordered_set<lldb::tid_t> running;
+    for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+    {
+        std::ifstream stat(it->path() / "stat");
+        std::string line;
+        std::getline(stat, line);
+
+        // "tid (comm) S ...", where comm may itself contain spaces and parentheses
+        const size_t comm_end = line.rfind(')');
+        if (comm_end != std::string::npos && comm_end + 2 < line.size() &&
+            line[comm_end + 2] == 'R')
+        {
+            running.insert(lldb::tid_t(std::stoull(it->path().filename().string())));
+        }
+    }
+    return running;
+#else
+    (void) pid;
+    return {};
+#endif
+}
+
+uint32_t SampleStore::intern(const std::vector<lldb::addr_t>& pcs)
+{
+    std::vector<uint32_t>& candidates = m_stacks_by_hash[hash_pcs(pcs)];
+    for (const uint32_t candidate : candidates)
+    {
+        const SampleStack& stack = m_stacks[candidate];
+        if (stack.depth == pcs.size() &&
+            std::equal(pcs.rbegin(), pcs.rend(), m_pcs.begin() + stack.offset))
+        {
+            return candidate;
+        }
+    }
+
+    const auto index = uint32_t(m_stacks.size());
+    m_stacks.push_back({uint32_t(m_pcs.size()), uint32_t(pcs.size())});
+    m_pcs.insert(m_pcs.end(), pcs.rbegin(), pcs.rend());
+    candidates.push_back(index);
+    return index;
+}
+
+void SampleStore::clear()
+{
+    m_pcs.clear();
+    m_stacks.clear();
+    m_samples.clear();
+    m_stacks_by_hash.clear();
+}
+
+Sampler::~Sampler()
+{
+    shutdown();
+}
+
+void Sampler::shutdown()
+{
+    m_stop_requested = true;
+
+    if (m_sampler.joinable())
+    {
+        m_sampler.join();
+    }
+}
+
+void Sampler::start(lldb::SBProcess& process, uint32_t rate_hz, bool running_only)
+{
+    if (m_active)
+    {
+        LOG(Warning) << "Attempted to start sampling while already sampling.";
+        return;
+    }
+
+    if (m_sampler.joinable())
+    {
+        m_sampler.join();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_store.clear();
+        m_stats = SamplerStats();
+        m_stats.session = ++m_session;
+    }
+
+    m_active = true;
+    m_deferred_event.Clear();
+    m_stop_requested = false;
+    m_stopped_externally = false;
+    m_sampling.store(true, std::memory_order_release);
+
+    rate_hz = std::clamp(rate_hz, 1U, 1000U);
+    LOG(Info) << "Sampling process " << process.GetProcessID() << " at " << rate_hz << " Hz";
+
+    m_sampler = std::thread(
+        [this, process, rate_hz, running_only]() { this->run(process, rate_hz, running_only); }
+    );
+}
+
+lldb::SBEvent Sampler::finish()
+{
+    if (m_sampler.joinable())
+    {
+        m_sampler.join();
+    }
+
+    m_active = false;
+
+    lldb::SBEvent event = m_deferred_event;
+    m_deferred_event.Clear();
+
+    if (!m_stopped_externally)
+    {
+        event.Clear();
+    }
+
+    const SamplerStats stats = this->stats();
+    LOG(Info) << "Collected " << stats.samples << " samples (" << stats.unique_stacks
+              << " unique stacks) in " << stats.interrupts
+              << " interrupts, the process was paused for " << stats.paused_ns / 1000000 << " of "
+              << stats.elapsed_ns / 1000000 << " ms";
+
+    return event;
+}
+
+SamplerStats Sampler::stats() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void Sampler::run(lldb::SBProcess process, uint32_t rate_hz, bool running_only)
+{
+    Defer(m_sampling.store(false, std::memory_order_release));
+
+    using Clock = std::chrono::steady_clock;
+    auto elapsed_ns = [](Clock::time_point from, Clock::time_point to)
+    { return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count()); };
+
+    // the signal an interrupt shows up as, where it shows up as one
+    const int32_t sigstop = process.GetUnixSignals().GetSignalNumberFromName("SIGSTOP");
+
+    const auto period = std::chrono::nanoseconds(1000000000 / rate_hz);
+    const Clock::time_point start = Clock::now();
+    Clock::time_point next_tick = start;
+
+    uint32_t last_stop_id = process.GetStopID();
+
+    // procfs only knows about processes on this machine
+    const char* platform = process.GetTarget().GetPlatform().GetName();
+    const bool is_local = platform != nullptr && std::string_view(platform) == "host";
+
+    std::vector<Sample> tick_samples;
+    std::vector<std::vector<lldb::addr_t>> tick_stacks;
+
+    for (uint32_t tick = 0; !m_stop_requested; tick++)
+    {
+        std::this_thread::sleep_until(next_tick);
+
+        // if the process was too slow to interrupt, skip the ticks that were missed
+        next_tick = std::max(next_tick + period, Clock::now());
+
+        const lldb::StateType state = process.GetState();
+        if (state == lldb::eStateStopped && process.GetStopID() == last_stop_id)
+        {
+            continue; // the resume from the previous tick hasn't been made public yet
+        }
+        if (state != lldb::eStateRunning)
+        {
+            m_stopped_externally = true;
+            break;
+        }
+
+        std::optional<std::unordered_set<lldb::tid_t>> running = {};
+        if (running_only && is_local)
+        {
+            running = find_running_threads(process.GetProcessID());
+        }
+
+        const Clock::time_point pause_start = Clock::now();
+
+        // Stop waits for the process to halt (and rebroadcasts the stop event,
+        // which the UI holds back), Continue returns as soon as it resumes
+        if (lldb::SBError err = process.Stop(); err.Fail())
+        {
+            LOG(Error) << "Sampler failed to stop the process: " << err.GetCString();
+            m_stopped_externally = process.GetState() != lldb::eStateRunning;
+            break;
+        }
+        last_stop_id = process.GetStopID();
+
+        tick_samples.clear();
+        tick_stacks.clear();
+
+        const uint32_t nthreads = process.GetNumThreads();
+        for (uint32_t i = 0; i < nthreads; i++)
+        {
+            lldb::SBThread th = process.GetThreadAtIndex(i);
+            if (!th.IsValid())
+            {
+                continue;
+            }
+
+            // A thread may have hit a breakpoint or crashed just before the
+            // interrupt landed. Then the stop is the user's, and the process
+            // must not be resumed.
+            const lldb::StopReason reason = th.GetStopReason();
+            const bool interrupted =
+                reason == lldb::eStopReasonNone || reason == lldb::eStopReasonInvalid ||
+                (reason == lldb::eStopReasonSignal &&
+                 th.GetStopReasonDataAtIndex(0) == uint64_t(sigstop));
+            if (!interrupted)
+            {
+                m_stopped_externally = true;
+            }
+
+            if (running.has_value() && running->count(th.GetThreadID()) == 0)
+            {
+                continue;
+            }
+
+            std::vector<lldb::addr_t>& pcs = tick_stacks.emplace_back();
+            for (uint32_t f = 0; f < MAX_FRAMES; f++)
+            {
+                lldb::SBFrame frame = th.GetFrameAtIndex(f);
+                if (!frame.IsValid())
+                {
+                    break;
+                }
+                pcs.push_back(frame.GetPC());
+            }
+
+            tick_samples.push_back({0, tick, th.GetIndexID()});
+        }
+
+        if (m_stopped_externally)
+        {
+            LOG(Info) << "Process stopped while sampling, sampling ended";
+        }
+        else if (lldb::SBError err = process.Continue(); err.Fail())
+        {
+            LOG(Error) << "Sampler failed to resume the process: " << err.GetCString();
+            m_stopped_externally = true;
+        }
+
+        const Clock::time_point pause_end = Clock::now();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < tick_samples.size(); i++)
+        {
+            tick_samples[i].stack = m_store.intern(tick_stacks[i]);
+            m_store.add(tick_samples[i]);
+        }
+
+        const uint64_t pause_ns = elapsed_ns(pause_start, pause_end);
+        m_stats.ticks = tick + 1;
+        m_stats.interrupts++;
+        m_stats.samples = m_store.samples().size();
+        m_stats.unique_stacks = m_store.unique_stacks();
+        m_stats.elapsed_ns = elapsed_ns(start, pause_end);
+        m_stats.paused_ns += pause_ns;
+        m_stats.max_pause_ns = std::max(m_stats.max_pause_ns, pause_ns);
+
+        if (m_stopped_externally)
+        {
+            break;
+        }
+    }
+}
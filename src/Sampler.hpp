@@ -0,0 +1,162 @@
+#pragma once
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct Sample
+{
+    uint32_t stack; // index into SampleStore::stacks
+    uint32_t tick;  // the interrupt this sample was taken in
+    uint32_t thread_index_id;
+};
+
+struct SampleStack
+{
+    uint32_t offset; // into SampleStore::pcs
+    uint32_t depth;
+};
+
+// Backtraces collected by the Sampler. Identical backtraces are only stored
+// once: their PCs (outermost frame first) live in one shared arena, and every
+// sample refers to its backtrace by index.
+class SampleStore
+{
+    std::vector<lldb::addr_t> m_pcs;
+    std::vector<SampleStack> m_stacks;
+    std::vector<Sample> m_samples;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_stacks_by_hash;
+
+  public:
+    // 'pcs' is innermost frame first, as unwound
+    uint32_t intern(const std::vector<lldb::addr_t>& pcs);
+
+    void add(const Sample& sample)
+    {
+        m_samples.push_back(sample);
+    }
+
+    void clear();
+
+    [[nodiscard]] const std::vector<Sample>& samples() const
+    {
+        return m_samples;
+    }
+
+    [[nodiscard]] size_t unique_stacks() const
+    {
+        return m_stacks.size();
+    }
+
+    [[nodiscard]] const SampleStack& stack(uint32_t i) const
+    {
+        return m_stacks[i];
+    }
+
+    [[nodiscard]] const lldb::addr_t* pcs(const SampleStack& stack) const
+    {
+        return m_pcs.data() + stack.offset;
+    }
+};
+
+struct SamplerStats
+{
+    uint32_t session = 0; // bumped by every 'start'
+    uint32_t ticks = 0;      // including the ones skipped while a resume was still pending
+    uint32_t interrupts = 0; // ticks that actually paused the process
+    size_t samples = 0;
+    size_t unique_stacks = 0;
+    uint64_t elapsed_ns = 0; // since sampling started
+    uint64_t paused_ns = 0;  // time the process spent interrupted by the sampler
+    uint64_t max_pause_ns = 0;
+};
+
+// A sampling profiler: interrupts the process at a fixed rate, records the
+// backtraces of its threads and resumes it right away.
+//
+// Sampling runs on its own thread and bypasses the UI's stop handling, which
+// is far too slow to run tens of times per second. While sampling is active
+// the UI holds back the process' state change events (see 'defer_event') and
+// must not otherwise touch the process. Sampling ends when asked to, or when
+// the process stops on its own (breakpoint, crash, exit), in which case the
+// held back event is handed back to the UI by 'finish'.
+class Sampler
+{
+    SampleStore m_store;
+    mutable std::mutex m_mutex; // guards m_store and m_stats
+    SamplerStats m_stats;
+    uint32_t m_session = 0;
+
+    std::atomic<bool> m_sampling = false;
+    std::atomic<bool> m_stop_requested = false;
+    std::atomic<bool> m_stopped_externally = false;
+    std::thread m_sampler;
+
+    // only touched by the UI thread
+    bool m_active = false;
+    lldb::SBEvent m_deferred_event;
+
+    void run(lldb::SBProcess process, uint32_t rate_hz, bool running_only);
+
+  public:
+    static constexpr uint32_t MAX_FRAMES = 128;
+
+    Sampler() = default;
+    ~Sampler();
+
+    Sampler(const Sampler&) = delete;
+    Sampler(Sampler&&) = delete;
+    Sampler& operator=(const Sampler&) = delete;
+    Sampler& operator=(Sampler&&) = delete;
+
+    // Starts sampling a running process, discarding any previous samples. With
+    // 'running_only', threads that are blocked (e.g. waiting on a lock or in a
+    // sleeping syscall) are skipped, where the OS lets us tell.
+    void start(lldb::SBProcess& process, uint32_t rate_hz, bool running_only);
+
+    // Asks the sampler to stop after the current sample; the process is left running.
+    void request_stop()
+    {
+        m_stop_requested = true;
+    }
+
+    // Stops sampling and waits for the sampling thread to exit.
+    void shutdown();
+
+    // true while the sampling thread runs
+    [[nodiscard]] bool is_sampling() const
+    {
+        return m_sampling.load(std::memory_order_acquire);
+    }
+
+    // true from 'start' until 'finish', i.e. until the UI has caught up with
+    // the events queued while sampling
+    [[nodiscard]] bool is_active() const
+    {
+        return m_active;
+    }
+
+    void defer_event(const lldb::SBEvent& event)
+    {
+        m_deferred_event = event;
+    }
+
+    // Ends an active session once the sampling thread is done. Returns the
+    // last held back process event if the process stopped by itself, and an
+    // invalid event otherwise.
+    lldb::SBEvent finish();
+
+    [[nodiscard]] SamplerStats stats() const;
+
+    // Calls 'f(const SampleStore&)' with the samples locked.
+    template <typename F> void read(F&& f) const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        f(m_store);
+    }
+};
@@ -0,0 +1,333 @@
+#include "SourceMap.hpp"
+
+#include "FileSystem.hpp"
+#include "Log.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+static bool is_separator(char c)
+{
+    return c == '/' || c == '\\';
+}
+
+// the non-root components of a path, e.g. /a/b/c.cpp -> {a, b, c.cpp}
+static std::vector<std::string> components(const fs::path& path)
+{
+    std::vector<std::string> result;
+    for (const fs::path& component : path.relative_path())
+    {
+        if (!component.empty())
+        {
+            result.push_back(to_utf8(component));
+        }
+    }
+    return result;
+}
+
+static size_t common_suffix_length(
+    const std::vector<std::string>& a, const std::vector<std::string>& b
+)
+{
+    size_t n = 0;
+    while (n < a.size() && n < b.size() && a[a.size() - 1 - n] == b[b.size() - 1 - n])
+    {
+        n++;
+    }
+    return n;
+}
+
+// drops the last 'count' components of a path
+static fs::path strip_suffix(const fs::path& path, size_t count)
+{
+    fs::path result = path;
+    for (size_t i = 0; i < count; i++)
+    {
+        result = result.parent_path();
+    }
+    return result;
+}
+
+static bool file_exists(const fs::path& path)
+{
+    std::error_code ec;
+    return fs::is_regular_file(path, ec);
+}
+
+SourceMap::SourceMap(fs::path workdir, FileFinder& files)
+    : m_workdir(std::move(workdir)), m_files(files)
+{
+}
+
+std::vector<SourceMapRule> SourceMap::parse_settings(std::string_view output)
+{
+    // target.source-map (path-map) =
+    // [0] "/build/root" -> "/home/me/src"
+    std::vector<SourceMapRule> rules;
+
+    auto next_quoted = [](std::string_view& line) -> std::optional<std::string_view>
+    {
+        const size_t begin = line.find('"');
+        if (begin == std::string_view::npos)
+        {
+            return {};
+        }
+        const size_t end = line.find('"', begin + 1);
+        if (end == std::string_view::npos)
+        {
+            return {};
+        }
+        std::string_view quoted = line.substr(begin + 1, end - begin - 1);
+        line.remove_prefix(end + 1);
+        return quoted;
+    };
+
+    while (!output.empty())
+    {
+        const size_t newline = output.find('\n');
+        std::string_view line = output.substr(0, newline);
+        output.remove_prefix(newline == std::string_view::npos ? output.size() : newline + 1);
+
+        if (line.find("->") == std::string_view::npos)
+        {
+            continue;
+        }
+
+        const std::optional<std::string_view> from = next_quoted(line);
+        const std::optional<std::string_view> to = next_quoted(line);
+        if (from.has_value() && to.has_value() && !from->empty())
+        {
+            rules.push_back({std::string(*from), std::string(*to)});
+        }
+    }
+
+    return rules;
+}
+
+void SourceMap::synchronize(LLDBCommandLine& cmdline)
+{
+    lldb::SBCommandReturnObject ret = cmdline.run_command("settings show target.source-map", true);
+    if (!ret.Succeeded() || ret.GetOutput() == nullptr)
+    {
+        return;
+    }
+
+    std::vector<SourceMapRule> rules = parse_settings(ret.GetOutput());
+    if (rules == m_rules)
+    {
+        return;
+    }
+
+    LOG(Info) << "target.source-map changed, " << rules.size() << " rules";
+    m_rules = std::move(rules);
+    m_resolved.clear();
+}
+
+std::optional<fs::path>
+SourceMap::apply_rules(const std::vector<SourceMapRule>& rules, const fs::path& recorded) const
+{
+    const std::string path = to_utf8(recorded);
+
+    for (const SourceMapRule& rule : rules)
+    {
+        // only match whole components, i.e. /build must not match /builds/foo.cpp
+        const bool prefix_matches =
+            path.compare(0, rule.from.size(), rule.from) == 0 &&
+            (path.size() == rule.from.size() || is_separator(rule.from.back()) ||
+             is_separator(path[rule.from.size()]));
+        if (!prefix_matches)
+        {
+            continue;
+        }
+
+        std::string_view rest = std::string_view(path).substr(rule.from.size());
+        while (!rest.empty() && is_separator(rest.front()))
+        {
+            rest.remove_prefix(1);
+        }
+
+        const fs::path candidate = fs::path(rule.to) / fs::path(rest);
+        if (file_exists(candidate))
+        {
+            return candidate.lexically_normal();
+        }
+    }
+
+    return {};
+}
+
+bool SourceMap::update_workdir_index()
+{
+    // checked before taking the snapshot, so that a finished crawl's last one is seen
+    const bool crawling = m_files.is_crawling();
+
+    std::shared_ptr<const FileIndex> index = m_files.index();
+    if (index == nullptr)
+    {
+        if (!crawling)
+        {
+            m_files.refresh(m_workdir, lldb::SBTarget());
+        }
+        return false;
+    }
+
+    // snapshots of the same crawl only ever grow, anything else starts over
+    const bool same_crawl = m_index != nullptr && !m_index->chunks.empty() &&
+                            index->chunks.front() == m_index->chunks.front() &&
+                            index->size >= m_indexed;
+    if (!same_crawl)
+    {
+        m_workdir_files_by_name.clear();
+        m_indexed = 0;
+    }
+    m_index = index;
+
+    for (; m_indexed < index->size; m_indexed++)
+    {
+        const FileEntry& entry = index->file(m_indexed);
+
+        // compile unit files outside of the working directory, see FileFinder::crawl
+        if (entry.display_offset == 0)
+        {
+            continue;
+        }
+        m_workdir_files_by_name[std::string(entry.name())].emplace_back(entry.path);
+    }
+
+    return !crawling;
+}
+
+// FNV-1a over the file contents
+uint64_t SourceMap::content_hash(const fs::path& path)
+{
+    const std::string key = to_utf8(path);
+    if (auto it = m_content_hashes.find(key); it != m_content_hashes.end())
+    {
+        return it->second;
+    }
+
+    uint64_t hash = 14695981039346656037ULL;
+
+    std::ifstream stream(path, std::ios::binary);
+    std::array<char, 4096> buf;
+    while (stream.read(buf.data(), buf.size()) || stream.gcount() > 0)
+    {
+        for (std::streamsize i = 0; i < stream.gcount(); i++)
+        {
+            hash ^= uint64_t(uint8_t(buf[size_t(i)]));
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    m_content_hashes.emplace(key, hash);
+    return hash;
+}
+
+std::optional<fs::path> SourceMap::search_workdir(const fs::path& recorded)
+{
+    const auto it = m_workdir_files_by_name.find(to_utf8(recorded.filename()));
+    if (it == m_workdir_files_by_name.end())
+    {
+        return {};
+    }
+
+    const std::vector<std::string> recorded_components = components(recorded);
+
+    size_t best_score = 0;
+    std::vector<const fs::path*> best;
+    for (const fs::path& candidate : it->second)
+    {
+        const size_t score = common_suffix_length(recorded_components, components(candidate));
+        if (score > best_score)
+        {
+            best_score = score;
+            best.clear();
+        }
+        if (score == best_score)
+        {
+            best.push_back(&candidate);
+        }
+    }
+
+    if (best.empty())
+    {
+        return {};
+    }
+
+    // copies of the same file (e.g. vendored headers) are equally good answers
+    const uint64_t hash = best.size() > 1 ? content_hash(*best.front()) : 0;
+    for (size_t i = 1; i < best.size(); i++)
+    {
+        if (content_hash(*best[i]) != hash)
+        {
+            LOG(Warning) << "Found " << best.size() << " different candidates for " << recorded
+                         << " under " << m_workdir
+                         << ", use 'settings set target.source-map' to pick one";
+            return {};
+        }
+    }
+
+    const fs::path& match = *best.front();
+
+    // The rest of the build tree most likely moved along with this file, so
+    // remember where to. Requires a matching directory, not just a file name.
+    if (best_score >= 2)
+    {
+        SourceMapRule rule;
+        rule.from = to_utf8(strip_suffix(recorded, best_score));
+        rule.to = to_utf8(strip_suffix(match, best_score));
+
+        if (std::find(m_learned_rules.begin(), m_learned_rules.end(), rule) ==
+            m_learned_rules.end())
+        {
+            LOG(Info) << "Mapping source path " << rule.from << " to " << rule.to;
+            m_learned_rules.push_back(std::move(rule));
+        }
+    }
+
+    return match.lexically_normal();
+}
+
+std::optional<fs::path> SourceMap::resolve(const fs::path& recorded)
+{
+    std::string key = to_utf8(recorded);
+    if (auto it = m_resolved.find(key); it != m_resolved.end())
+    {
+        return it->second;
+    }
+
+    std::optional<fs::path> resolved = apply_rules(m_rules, recorded);
+
+    if (!resolved.has_value() && file_exists(recorded))
+    {
+        resolved = recorded;
+    }
+
+    if (!resolved.has_value())
+    {
+        resolved = apply_rules(m_learned_rules, recorded);
+    }
+
+    if (!resolved.has_value())
+    {
+        const bool index_complete = update_workdir_index();
+        resolved = search_workdir(recorded);
+
+        // the file may still turn up in the rest of the crawl
+        if (!resolved.has_value() && !index_complete)
+        {
+            return {};
+        }
+    }
+
+    if (!resolved.has_value())
+    {
+        LOG(Warning) << "Unable to locate source file: " << key;
+    }
+
+    m_resolved.emplace(std::move(key), resolved);
+    return resolved;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "FileFinder.hpp"
+#include "LLDBCommandLine.hpp"
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Rewrites paths starting with 'from' (at a path component boundary) to start with 'to'.
+struct SourceMapRule
+{
+    std::string from;
+    std::string to;
+
+    friend bool operator==(const SourceMapRule& a, const SourceMapRule& b)
+    {
+        return a.from == b.from && a.to == b.to;
+    }
+};
+
+// Maps the source paths recorded in debug info to files on this machine.
+//
+// Binaries built elsewhere (e.g. in a CI container) record directories that
+// don't exist locally. A path is resolved by, in order:
+//   1. the prefix rules of lldb's 'target.source-map' setting
+//   2. the path as recorded, if it exists
+//   3. rules learned from earlier fallback searches
+//   4. a search of the working directory for files with the same name, picking
+//      the one sharing the longest trailing run of directories with the
+//      recorded path. Equally good candidates with identical contents (by
+//      hash) are treated as the same file, otherwise the match is ambiguous.
+//
+// The working directory search looks files up in the FileFinder's index,
+// which is crawled in the background; the first search starts the crawl if
+// the file finder hasn't yet. New snapshots of the index are added to the
+// lookup table by name as they are published.
+//
+// Every (directory, filename) pair is only resolved once, the result (found
+// or not) is cached until the rules change. Misses aren't cached while the
+// crawl is still running.
+class SourceMap
+{
+    std::filesystem::path m_workdir;
+
+    std::vector<SourceMapRule> m_rules;         // mirrors target.source-map
+    std::vector<SourceMapRule> m_learned_rules; // inferred from fallback matches
+
+    std::unordered_map<std::string, std::optional<std::filesystem::path>> m_resolved;
+
+    FileFinder& m_files;
+    std::shared_ptr<const FileIndex> m_index; // the snapshot m_workdir_files_by_name is built from
+    size_t m_indexed = 0;                     // files of m_index added so far
+    std::unordered_map<std::string, std::vector<std::filesystem::path>> m_workdir_files_by_name;
+    std::unordered_map<std::string, uint64_t> m_content_hashes;
+
+    // returns false if the index is still incomplete
+    bool update_workdir_index();
+    uint64_t content_hash(const std::filesystem::path& path);
+
+    std::optional<std::filesystem::path> apply_rules(
+        const std::vector<SourceMapRule>& rules, const std::filesystem::path& recorded
+    ) const;
+    std::optional<std::filesystem::path> search_workdir(const std::filesystem::path& recorded);
+
+  public:
+    SourceMap(std::filesystem::path workdir, FileFinder& files);
+
+    // Re-reads target.source-map, dropping all cached resolutions if it changed.
+    void synchronize(LLDBCommandLine& cmdline);
+
+    // Parses the output of 'settings show target.source-map'.
+    static std::vector<SourceMapRule> parse_settings(std::string_view output);
+
+    std::optional<std::filesystem::path> resolve(const std::filesystem::path& recorded);
+
+    std::optional<std::filesystem::path> resolve(const char* directory, const char* filename)
+    {
+        if (filename == nullptr || filename[0] == '\0')
+        {
+            return {};
+        }
+
+        return resolve(
+            directory != nullptr ? std::filesystem::path(directory) / filename
+                                 : std::filesystem::path(filename)
+        );
+    }
+
+    std::optional<std::filesystem::path> resolve(const lldb::SBFileSpec& spec)
+    {
+        return resolve(spec.GetDirectory(), spec.GetFilename());
+    }
+};
@@ -0,0 +1,68 @@
+#include "StackTrace.hpp"
+
+#include "Log.hpp"
+
+void StackTrace::synchronize(lldb::SBProcess& process, lldb::SBThread& thread)
+{
+    const uint32_t stop_id = process.GetStopID();
+    const lldb::tid_t thread_id = thread.GetThreadID();
+
+    if (m_process.IsValid() && process.GetUniqueID() == m_process.GetUniqueID() &&
+        stop_id == m_stop_id && thread_id == m_thread_id)
+    {
+        return;
+    }
+
+    m_process = process;
+    m_thread = thread;
+    m_stop_id = stop_id;
+    m_thread_id = thread_id;
+    m_frames.clear();
+    m_complete = false;
+}
+
+void StackTrace::ensure_loaded(uint32_t count, SourceMap& source_map)
+{
+    while (!m_complete && m_frames.size() < count)
+    {
+        load_page(source_map);
+    }
+}
+
+void StackTrace::load_page(SourceMap& source_map)
+{
+    const auto begin = uint32_t(m_frames.size());
+    const uint32_t end = begin + PAGE_SIZE;
+
+    for (uint32_t i = begin; i < end; i++)
+    {
+        lldb::SBFrame frame = m_thread.GetFrameAtIndex(i);
+        if (!frame.IsValid())
+        {
+            m_complete = true;
+            LOG(Verbose) << "Unwound all " << m_frames.size() << " frames of thread "
+                         << m_thread_id;
+            return;
+        }
+
+        lldb::SBLineEntry line_entry = frame.GetLineEntry();
+        lldb::SBFileSpec spec = line_entry.GetFileSpec();
+        const char* function_name = frame.GetDisplayFunctionName();
+        const char* filename = spec.GetFilename();
+        const char* directory = spec.GetDirectory();
+
+        StackTraceFrame entry;
+        entry.pc = frame.GetPC();
+        entry.function_name = function_name != nullptr ? std::string(function_name) : "???";
+        entry.line = line_entry.GetLine();
+        entry.column = line_entry.GetColumn();
+
+        if (auto filepath = source_map.resolve(directory, filename); filepath.has_value())
+        {
+            entry.filepath = std::move(*filepath);
+            entry.filename = filename;
+        }
+
+        m_frames.emplace_back(std::move(entry));
+    }
+}
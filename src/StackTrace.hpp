@@ -0,0 +1,66 @@
+#pragma once
+
+#include "SourceMap.hpp"
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct StackTraceFrame
+{
+    lldb::addr_t pc;
+    std::string function_name;
+    std::filesystem::path filepath; // empty if no local source file was found for this frame
+    std::string filename;
+    uint32_t line;
+    uint32_t column;
+};
+
+// The frames of the viewed thread, unwound on demand.
+//
+// SBThread::GetNumFrames unwinds the entire stack, which for a runaway
+// recursion can be hundreds of thousands of frames. Frames are instead loaded
+// in pages with SBThread::GetFrameAtIndex, which only unwinds as far as the
+// requested index, and only as far as the UI has asked for. Until the bottom
+// of the stack has been reached the frame count is only a lower bound.
+class StackTrace
+{
+    lldb::SBProcess m_process;
+    lldb::SBThread m_thread;
+    uint32_t m_stop_id = 0;
+    lldb::tid_t m_thread_id = LLDB_INVALID_THREAD_ID;
+
+    std::vector<StackTraceFrame> m_frames;
+    bool m_complete = false;
+
+    void load_page(SourceMap& source_map);
+
+  public:
+    static constexpr uint32_t PAGE_SIZE = 128;
+
+    // Drops all loaded frames if the process stopped again or a different
+    // thread is viewed.
+    void synchronize(lldb::SBProcess& process, lldb::SBThread& thread);
+
+    // Unwinds until at least 'count' frames are loaded, or the stack ends.
+    void ensure_loaded(uint32_t count, SourceMap& source_map);
+
+    [[nodiscard]] uint32_t loaded() const
+    {
+        return uint32_t(m_frames.size());
+    }
+
+    // true once the bottom of the stack has been reached, i.e. 'loaded' is exact
+    [[nodiscard]] bool complete() const
+    {
+        return m_complete;
+    }
+
+    [[nodiscard]] const StackTraceFrame& frame(uint32_t i) const
+    {
+        return m_frames[i];
+    }
+};
@@ -0,0 +1,278 @@
+#include "SymbolIndex.hpp"
+
+#include "Defer.hpp"
+#include "Log.hpp"
+#include "Timer.hpp"
+
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+static constexpr size_t SYMBOLS_PER_TASK = 16384;
+
+SymbolIndex::SymbolIndex() : m_pool(0) {}
+
+SymbolIndex::~SymbolIndex()
+{
+    shutdown();
+}
+
+void SymbolIndex::shutdown()
+{
+    m_generation++;
+
+    if (m_indexer.joinable())
+    {
+        m_indexer.join();
+    }
+}
+
+std::shared_ptr<const SymbolTable> SymbolIndex::table()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_table;
+}
+
+void SymbolIndex::request(lldb::SBTarget& target)
+{
+    const uint32_t nmodules = target.GetNumModules();
+    if (target == m_target && nmodules == m_indexed_module_count)
+    {
+        return;
+    }
+
+    // NOTE: never wait for a running build here, a single large module can take
+    // seconds to parse. A build for another target is told to stop early, and
+    // either way the request is picked up again once the build has finished.
+    if (is_indexing())
+    {
+        if (target != m_target)
+        {
+            m_generation++;
+        }
+        return;
+    }
+
+    if (m_indexer.joinable())
+    {
+        m_indexer.join();
+    }
+
+    const uint64_t generation = ++m_generation;
+    m_target = target;
+    m_indexed_module_count = nmodules;
+    m_modules_done = 0;
+    m_modules_total = nmodules;
+    m_indexing.store(true, std::memory_order_release);
+
+    m_indexer = std::thread([this, target, generation]() { this->build(target, generation); });
+}
+
+void SymbolIndex::build(lldb::SBTarget target, uint64_t generation)
+{
+    Defer(m_indexing.store(false, std::memory_order_release));
+
+    Timer timer;
+
+    struct PendingSymbol
+    {
+        std::string name;
+        lldb::addr_t file_address;
+        uint32_t module_index;
+        SymbolKind kind;
+    };
+
+    auto table = std::make_shared<SymbolTable>();
+    std::vector<PendingSymbol> pending;
+
+    const uint32_t nmodules = target.GetNumModules();
+    for (uint32_t m = 0; m < nmodules; m++)
+    {
+        if (m_generation.load() != generation)
+        {
+            return;
+        }
+
+        lldb::SBModule module = target.GetModuleAtIndex(m);
+        if (!module.IsValid())
+        {
+            continue;
+        }
+
+        const auto module_index = uint32_t(table->modules.size());
+        table->modules.push_back(module);
+
+        // functions found in the symbol table, so the debug info doesn't add them again
+        std::unordered_set<lldb::addr_t> function_addresses;
+
+        const size_t nsymbols = module.GetNumSymbols();
+        for (size_t i = 0; i < nsymbols; i++)
+        {
+            lldb::SBSymbol symbol = module.GetSymbolAtIndex(i);
+
+            SymbolKind kind;
+            switch (symbol.GetType())
+            {
+            case lldb::eSymbolTypeCode:
+                kind = SymbolKind::Function;
+                break;
+            case lldb::eSymbolTypeData:
+                kind = SymbolKind::Data;
+                break;
+            default:
+                continue;
+            }
+
+            const char* name = symbol.GetDisplayName();
+            if (name == nullptr || name[0] == '\0')
+            {
+                continue;
+            }
+
+            const lldb::addr_t file_address = symbol.GetStartAddress().GetFileAddress();
+            pending.push_back({name, file_address, module_index, kind});
+            if (kind == SymbolKind::Function)
+            {
+                function_addresses.insert(file_address);
+            }
+        }
+
+        // Stripped or partially stripped modules can still describe functions in
+        // their debug info (static and internal ones especially). The SB API has
+        // no list of a compile unit's functions, so walk its line table, which
+        // covers all of them, and skip the entries inside the last function seen.
+        const uint32_t ncompile_units = module.GetNumCompileUnits();
+        for (uint32_t c = 0; c < ncompile_units; c++)
+        {
+            if (m_generation.load() != generation)
+            {
+                return;
+            }
+
+            lldb::SBCompileUnit compile_unit = module.GetCompileUnitAtIndex(c);
+            lldb::addr_t function_start = LLDB_INVALID_ADDRESS;
+            lldb::addr_t function_end = LLDB_INVALID_ADDRESS;
+
+            const uint32_t nentries = compile_unit.GetNumLineEntries();
+            for (uint32_t i = 0; i < nentries; i++)
+            {
+                lldb::SBAddress address = compile_unit.GetLineEntryAtIndex(i).GetStartAddress();
+                const lldb::addr_t entry_address = address.GetFileAddress();
+                if (entry_address >= function_start && entry_address < function_end)
+                {
+                    continue;
+                }
+
+                lldb::SBFunction function = address.GetFunction();
+                if (!function.IsValid())
+                {
+                    continue;
+                }
+
+                function_start = function.GetStartAddress().GetFileAddress();
+                function_end = function.GetEndAddress().GetFileAddress();
+                if (!function_addresses.insert(function_start).second)
+                {
+                    continue;
+                }
+
+                const char* name = function.GetDisplayName();
+                if (name != nullptr && name[0] != '\0')
+                {
+                    pending.push_back({name, function_start, module_index, SymbolKind::Function});
+                }
+            }
+        }
+
+        m_modules_done++;
+    }
+
+    std::sort(
+        pending.begin(), pending.end(),
+        [](const PendingSymbol& a, const PendingSymbol& b) { return a.name < b.name; }
+    );
+
+    // intern: since the names are sorted, duplicates are adjacent
+    table->symbols.reserve(pending.size());
+    const std::string* previous_name = nullptr;
+    for (const PendingSymbol& p : pending)
+    {
+        if (previous_name == nullptr || p.name != *previous_name)
+        {
+            table->names.insert(table->names.end(), p.name.begin(), p.name.end());
+            previous_name = &p.name;
+        }
+
+        SymbolRecord record;
+        record.name_length = uint32_t(p.name.size());
+        record.name_offset = uint32_t(table->names.size()) - record.name_length;
+        record.file_address = p.file_address;
+        record.module_index = p.module_index;
+        record.kind = p.kind;
+        table->symbols.push_back(record);
+    }
+    table->names.shrink_to_fit();
+
+    if (m_generation.load() != generation)
+    {
+        return;
+    }
+
+    LOG(Info) << "Indexed " << table->symbols.size() << " symbols from " << nmodules
+              << " modules in " << timer.elapsed_ns() / 1000000 << " ms";
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_table = std::move(table);
+}
+
+std::vector<SymbolMatch> SymbolIndex::query(
+    ThreadPool& pool, const SymbolTable& table, std::string_view pattern, size_t max_results
+)
+{
+    std::vector<SymbolMatch> results;
+
+    if (pattern.empty())
+    {
+        const size_t n = std::min(max_results, table.symbols.size());
+        for (size_t i = 0; i < n; i++)
+        {
+            results.push_back({uint32_t(i), 0});
+        }
+        return results;
+    }
+
+    return fuzzy_top_k(
+        pool, table.symbols.size(), SYMBOLS_PER_TASK, max_results,
+        [&](size_t i) { return fuzzy_match(pattern, table.name(table.symbols[i])); }
+    );
+}
+
+std::optional<std::pair<fs::path, uint32_t>>
+SymbolIndex::resolve_location(const SymbolTable& table, const SymbolRecord& symbol)
+{
+    lldb::SBModule module = table.modules[symbol.module_index];
+    lldb::SBAddress address = module.ResolveFileAddress(symbol.file_address);
+
+    lldb::SBLineEntry line_entry = address.GetLineEntry();
+    if (!line_entry.IsValid())
+    {
+        lldb::SBFunction function = address.GetFunction();
+        if (function.IsValid())
+        {
+            line_entry = function.GetStartAddress().GetLineEntry();
+        }
+    }
+
+    lldb::SBFileSpec spec = line_entry.GetFileSpec();
+    const char* filename = spec.GetFilename();
+    const char* directory = spec.GetDirectory();
+
+    if (!line_entry.IsValid() || filename == nullptr || directory == nullptr)
+    {
+        return {};
+    }
+
+    return std::make_pair(fs::path(directory) / fs::path(filename), line_entry.GetLine());
+}
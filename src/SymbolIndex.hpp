@@ -0,0 +1,120 @@
+#pragma once
+
+#include "FuzzyMatch.hpp"
+#include "ThreadPool.hpp"
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum class SymbolKind : std::uint8_t
+{
+    Function,
+    Data,
+};
+
+struct SymbolRecord
+{
+    uint32_t name_offset; // into SymbolTable::names
+    uint32_t name_length;
+    lldb::addr_t file_address;
+    uint32_t module_index; // into SymbolTable::modules
+    SymbolKind kind;
+};
+
+// An immutable table of all code and data symbols of a target, plus the functions
+// only described by debug info.
+// Names are stored once each in a single character arena, and the records are
+// sorted by name.
+struct SymbolTable
+{
+    std::vector<char> names;
+    std::vector<SymbolRecord> symbols;
+    std::vector<lldb::SBModule> modules;
+
+    [[nodiscard]] std::string_view name(const SymbolRecord& symbol) const
+    {
+        return std::string_view(names.data() + symbol.name_offset, symbol.name_length);
+    }
+};
+
+// 'index' is an index into SymbolTable::symbols
+using SymbolMatch = FuzzyMatchResult;
+
+// Indexes the symbols of every module of a target on a background thread, and
+// answers fuzzy queries over the index by scoring it in parallel.
+//
+// The index is rebuilt from scratch when the target or its number of modules
+// changes (e.g. shared libraries loaded after launch). Until the new index is
+// done, queries keep running against the previous one.
+class SymbolIndex
+{
+    ThreadPool m_pool;
+
+    std::mutex m_mutex; // guards m_table
+    std::shared_ptr<const SymbolTable> m_table;
+
+    lldb::SBTarget m_target;
+    uint32_t m_indexed_module_count = 0;
+    std::atomic<uint64_t> m_generation = 0;
+    std::atomic<bool> m_indexing = false;
+    std::atomic<uint32_t> m_modules_done = 0;
+    std::atomic<uint32_t> m_modules_total = 0;
+
+    std::thread m_indexer;
+
+    void build(lldb::SBTarget target, uint64_t generation);
+
+  public:
+    SymbolIndex();
+    ~SymbolIndex();
+
+    SymbolIndex(const SymbolIndex&) = delete;
+    SymbolIndex(SymbolIndex&&) = delete;
+    SymbolIndex& operator=(const SymbolIndex&) = delete;
+    SymbolIndex& operator=(SymbolIndex&&) = delete;
+
+    // Starts (re-)indexing if the target or its modules changed since the
+    // last request. Cheap to call every frame.
+    void request(lldb::SBTarget& target);
+
+    void shutdown();
+
+    [[nodiscard]] std::shared_ptr<const SymbolTable> table();
+
+    // Returns the best 'max_results' matches, best first. An empty pattern
+    // returns the first symbols in name order.
+    static std::vector<SymbolMatch> query(
+        ThreadPool& pool, const SymbolTable& table, std::string_view pattern, size_t max_results
+    );
+
+    std::vector<SymbolMatch>
+    query(const SymbolTable& table, std::string_view pattern, size_t max_results)
+    {
+        return query(m_pool, table, pattern, max_results);
+    }
+
+    // Resolves the source location of a symbol. Done lazily, only for the
+    // symbol the user picks, since line tables are expensive to look up.
+    static std::optional<std::pair<std::filesystem::path, uint32_t>>
+    resolve_location(const SymbolTable& table, const SymbolRecord& symbol);
+
+    [[nodiscard]] bool is_indexing() const
+    {
+        return m_indexing.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] std::pair<uint32_t, uint32_t> progress() const
+    {
+        return {m_modules_done.load(), m_modules_total.load()};
+    }
+};
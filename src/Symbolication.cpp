@@ -0,0 +1,26 @@
+#include "Symbolication.hpp"
+
+#include "fmt/format.h"
+
+std::string resolve_function_name(lldb::SBTarget& target, lldb::addr_t pc)
+{
+    lldb::SBAddress address = target.ResolveLoadAddress(pc);
+
+    if (lldb::SBFunction function = address.GetFunction(); function.IsValid())
+    {
+        if (const char* name = function.GetDisplayName(); name != nullptr)
+        {
+            return name;
+        }
+    }
+
+    if (lldb::SBSymbol symbol = address.GetSymbol(); symbol.IsValid())
+    {
+        if (const char* name = symbol.GetDisplayName(); name != nullptr)
+        {
+            return name;
+        }
+    }
+
+    return fmt::format("0x{:x}", pc);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <string>
+
+// The display name of the function (or, without debug info, the symbol)
+// containing 'pc', or the address itself if there is neither.
+std::string resolve_function_name(lldb::SBTarget& target, lldb::addr_t pc);
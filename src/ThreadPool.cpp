@@ -0,0 +1,105 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t nthreads)
+{
+    if (nthreads == 0)
+    {
+        nthreads = std::max(size_t(1), size_t(std::thread::hardware_concurrency()));
+    }
+
+    m_workers.reserve(nthreads);
+    for (size_t i = 0; i < nthreads; i++)
+    {
+        m_workers.emplace_back([this]() { this->worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+        m_tasks.clear();
+    }
+
+    m_cv.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_tasks.emplace_back(std::move(task));
+    }
+
+    m_cv.notify_one();
+}
+
+void ThreadPool::parallel_for(
+    size_t count, size_t chunk_size, const std::function<void(size_t, size_t)>& f
+)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    chunk_size = std::max(size_t(1), chunk_size);
+    const size_t nchunks = (count + chunk_size - 1) / chunk_size;
+
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    size_t remaining = nchunks;
+
+    for (size_t chunk = 0; chunk < nchunks; chunk++)
+    {
+        const size_t begin = chunk * chunk_size;
+        const size_t end = std::min(count, begin + chunk_size);
+
+        submit(
+            [&, begin, end]()
+            {
+                f(begin, end);
+
+                std::unique_lock<std::mutex> lock(done_mutex);
+                if (--remaining == 0)
+                {
+                    done_cv.notify_one();
+                }
+            }
+        );
+    }
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done_cv.wait(lock, [&remaining]() { return remaining == 0; });
+}
+
+void ThreadPool::worker_loop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return m_shutdown || !m_tasks.empty(); });
+
+            if (m_shutdown)
+            {
+                return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task();
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed-size pool of worker threads consuming a shared task queue.
+class ThreadPool
+{
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_shutdown = false;
+
+    // declared last, so that everything the workers touch is constructed first
+    std::vector<std::thread> m_workers;
+
+    void worker_loop();
+
+  public:
+    // 0 picks the number of hardware threads
+    explicit ThreadPool(size_t nthreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Splits [0, count) into chunks of at most 'chunk_size' elements, calls
+    // 'f(begin, end)' for each chunk on the pool and blocks until all chunks
+    // have finished.
+    // NOTE: must not be called from one of the pool's own workers
+    void parallel_for(
+        size_t count, size_t chunk_size, const std::function<void(size_t, size_t)>& f
+    );
+
+    [[nodiscard]] size_t size() const
+    {
+        return m_workers.size();
+    }
+};
@@ -0,0 +1,203 @@
+#include "Threads.hpp"
+
+#include "Log.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+
+const char* stop_reason_to_string(lldb::StopReason reason)
+{
+    switch (reason)
+    {
+    case lldb::eStopReasonInvalid:
+        return "invalid";
+    case lldb::eStopReasonNone:
+        return "none";
+    case lldb::eStopReasonTrace:
+        return "trace";
+    case lldb::eStopReasonBreakpoint:
+        return "breakpoint";
+    case lldb::eStopReasonWatchpoint:
+        return "watchpoint";
+    case lldb::eStopReasonSignal:
+        return "signal";
+    case lldb::eStopReasonException:
+        return "exception";
+    case lldb::eStopReasonExec:
+        return "exec";
+    case lldb::eStopReasonPlanComplete:
+        return "plan complete";
+    case lldb::eStopReasonThreadExiting:
+        return "exiting";
+    case lldb::eStopReasonInstrumentation:
+        return "instrumentation";
+    default:
+        return "other";
+    }
+}
+
+static void append_lowercase(std::string& out, std::string_view s)
+{
+    for (const char c : s)
+    {
+        out.push_back(char(std::tolower(static_cast<unsigned char>(c))));
+    }
+}
+
+void ThreadList::synchronize(lldb::SBProcess& process)
+{
+    const uint32_t stop_id = process.GetStopID();
+    if (m_process.IsValid() && process.GetUniqueID() == m_process.GetUniqueID() &&
+        stop_id == m_stop_id)
+    {
+        return;
+    }
+
+    m_process = process;
+    m_stop_id = stop_id;
+    m_threads.clear();
+    m_stopped.clear();
+    m_index_by_tid.clear();
+
+    const uint32_t nthreads = process.GetNumThreads();
+    m_threads.reserve(nthreads);
+    m_index_by_tid.reserve(nthreads);
+
+    std::array<char, 256> description = {};
+
+    for (uint32_t i = 0; i < nthreads; i++)
+    {
+        lldb::SBThread th = process.GetThreadAtIndex(i);
+        if (!th.IsValid())
+        {
+            LOG(Warning) << "Encountered invalid thread";
+            continue;
+        }
+
+        const char* name = th.GetName();
+
+        ThreadInfo info;
+        info.index = i;
+        info.index_id = th.GetIndexID();
+        info.id = th.GetThreadID();
+        info.stop_reason = th.GetStopReason();
+        info.name = name != nullptr ? std::string(name) : std::string();
+
+        if (info.stop_reason != lldb::eStopReasonNone &&
+            th.GetStopDescription(description.data(), description.size()) > 0)
+        {
+            info.stop_description = std::string(description.data());
+        }
+        else
+        {
+            info.stop_description = stop_reason_to_string(info.stop_reason);
+        }
+
+        // only the top frame is needed, which doesn't require a full unwind
+        const char* function_name = th.GetFrameAtIndex(0).GetDisplayFunctionName();
+        info.function_name = function_name != nullptr ? std::string(function_name) : "???";
+
+        append_lowercase(info.search_text, info.name);
+        info.search_text.push_back('\n');
+        append_lowercase(info.search_text, info.stop_description);
+        info.search_text.push_back('\n');
+        append_lowercase(info.search_text, info.function_name);
+
+        const auto index = uint32_t(m_threads.size());
+        if (info.stop_reason != lldb::eStopReasonNone &&
+            info.stop_reason != lldb::eStopReasonInvalid)
+        {
+            m_stopped.push_back(index);
+        }
+        m_index_by_tid.emplace(info.id, index);
+
+        m_threads.emplace_back(std::move(info));
+    }
+
+    LOG(Verbose) << "Captured " << m_threads.size() << " threads at stop " << stop_id;
+
+    rebuild_view();
+}
+
+void ThreadList::set_filter(std::string_view filter, bool stopped_only)
+{
+    std::string lowered;
+    append_lowercase(lowered, filter);
+
+    if (lowered == m_filter && stopped_only == m_stopped_only)
+    {
+        return;
+    }
+
+    m_filter = std::move(lowered);
+    m_stopped_only = stopped_only;
+    rebuild_view();
+}
+
+void ThreadList::set_sort(ThreadSortColumn column, bool ascending)
+{
+    if (column == m_sort_column && ascending == m_sort_ascending)
+    {
+        return;
+    }
+
+    m_sort_column = column;
+    m_sort_ascending = ascending;
+    rebuild_view();
+}
+
+void ThreadList::rebuild_view()
+{
+    m_view.clear();
+    m_view.reserve(m_threads.size());
+
+    for (uint32_t i = 0; i < uint32_t(m_threads.size()); i++)
+    {
+        const ThreadInfo& info = m_threads[i];
+
+        if (m_stopped_only && info.stop_reason == lldb::eStopReasonNone)
+        {
+            continue;
+        }
+
+        if (!m_filter.empty() && info.search_text.find(m_filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        m_view.push_back(i);
+    }
+
+    auto less = [this](uint32_t a, uint32_t b)
+    {
+        const ThreadInfo& x = m_threads[a];
+        const ThreadInfo& y = m_threads[b];
+
+        switch (m_sort_column)
+        {
+        case ThreadSortColumn::IndexID:
+            return x.index_id < y.index_id;
+        case ThreadSortColumn::ThreadID:
+            return x.id < y.id;
+        case ThreadSortColumn::Name:
+            return x.name < y.name;
+        case ThreadSortColumn::StopReason:
+            return x.stop_description < y.stop_description;
+        case ThreadSortColumn::Function:
+            return x.function_name < y.function_name;
+        }
+        return false;
+    };
+
+    if (m_sort_ascending)
+    {
+        std::stable_sort(m_view.begin(), m_view.end(), less);
+    }
+    else
+    {
+        std::stable_sort(
+            m_view.begin(), m_view.end(), [&less](uint32_t a, uint32_t b) { return less(b, a); }
+        );
+    }
+}
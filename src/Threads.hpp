@@ -0,0 +1,89 @@
+#pragma once
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Display information for a single thread, captured once per stop.
+struct ThreadInfo
+{
+    uint32_t index;    // position in the process' thread list, see SBProcess::GetThreadAtIndex
+    uint32_t index_id; // lldb's stable "thread #N" id
+    lldb::tid_t id;
+    lldb::StopReason stop_reason;
+    std::string name;
+    std::string stop_description;
+    std::string function_name; // of the top frame
+    std::string search_text;   // lowercased name, stop description and function name
+};
+
+enum class ThreadSortColumn : std::uint8_t
+{
+    IndexID,
+    ThreadID,
+    Name,
+    StopReason,
+    Function,
+};
+
+const char* stop_reason_to_string(lldb::StopReason reason);
+
+// Snapshot of all threads of the process, re-read only when the process stops
+// again. Processes with thousands of threads would otherwise pay for one
+// SBThread round trip per thread per rendered frame.
+//
+// The filtered and sorted order is kept in a separate view of indices, which
+// is only recomputed when the snapshot, the filter or the sort order changes.
+class ThreadList
+{
+    lldb::SBProcess m_process;
+    uint32_t m_stop_id = 0;
+    std::vector<ThreadInfo> m_threads;
+    std::vector<uint32_t> m_stopped; // indices of threads that have a stop reason
+    std::unordered_map<lldb::tid_t, uint32_t> m_index_by_tid;
+
+    std::vector<uint32_t> m_view; // indices into m_threads
+    std::string m_filter;         // lowercased
+    bool m_stopped_only = false;
+    ThreadSortColumn m_sort_column = ThreadSortColumn::IndexID;
+    bool m_sort_ascending = true;
+
+    void rebuild_view();
+
+  public:
+    void synchronize(lldb::SBProcess& process);
+
+    // 'stopped_only' hides threads that don't have a stop reason
+    void set_filter(std::string_view filter, bool stopped_only);
+    void set_sort(ThreadSortColumn column, bool ascending);
+
+    [[nodiscard]] const std::vector<uint32_t>& view() const
+    {
+        return m_view;
+    }
+
+    [[nodiscard]] const ThreadInfo& thread(uint32_t i) const
+    {
+        return m_threads[i];
+    }
+
+    [[nodiscard]] const ThreadInfo* find(lldb::tid_t id) const
+    {
+        auto it = m_index_by_tid.find(id);
+        return it != m_index_by_tid.end() ? &m_threads[it->second] : nullptr;
+    }
+
+    [[nodiscard]] const std::vector<uint32_t>& stopped() const
+    {
+        return m_stopped;
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return m_threads.size();
+    }
+};
@@ -0,0 +1,164 @@
+#include "Tracepoints.hpp"
+
+#include "Log.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static void copy_truncated(std::array<char, TraceRecord::VALUE_SIZE>& dst, const char* src)
+{
+    const size_t len = std::min(std::strlen(src), dst.size() - 1);
+    std::memcpy(dst.data(), src, len);
+    dst[len] = '\0';
+}
+
+bool Tracepoints::on_hit(
+    void* baton, lldb::SBProcess&, lldb::SBThread& thread, lldb::SBBreakpointLocation&
+)
+{
+    auto* tracepoint = static_cast<Tracepoint*>(baton);
+    tracepoint->hits.fetch_add(1, std::memory_order_relaxed);
+
+    Tracepoints& owner = *tracepoint->owner;
+    TraceRecord* record = owner.m_ring.reserve();
+    if (record == nullptr)
+    {
+        return false;
+    }
+
+    record->timestamp_ns = uint64_t(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - owner.m_epoch).count()
+    );
+    record->tracepoint = tracepoint->index;
+    record->thread_index_id = thread.GetIndexID();
+    record->nvalues = uint32_t(tracepoint->expressions.size());
+
+    lldb::SBFrame frame = thread.GetFrameAtIndex(0);
+    for (uint32_t i = 0; i < record->nvalues; i++)
+    {
+        lldb::SBValue value = frame.GetValueForVariablePath(tracepoint->expressions[i].c_str());
+
+        const char* text = nullptr;
+        if (value.IsValid() && value.GetError().Success())
+        {
+            text = value.GetValue();
+            if (text == nullptr)
+            {
+                text = value.GetSummary();
+            }
+        }
+        copy_truncated(record->values[i], text != nullptr ? text : "<unavailable>");
+    }
+
+    owner.m_ring.commit();
+
+    return false; // never stop
+}
+
+bool Tracepoints::add(
+    lldb::SBTarget& target, const std::string& file, uint32_t line,
+    std::vector<std::string> expressions
+)
+{
+    if (expressions.size() > TraceRecord::MAX_VALUES)
+    {
+        LOG(Warning) << "Tracepoints record at most " << TraceRecord::MAX_VALUES
+                     << " expressions, ignoring the rest";
+        expressions.resize(TraceRecord::MAX_VALUES);
+    }
+
+    lldb::SBBreakpoint breakpoint = target.BreakpointCreateByLocation(file.c_str(), line);
+    if (!breakpoint.IsValid())
+    {
+        LOG(Error) << "Failed to create tracepoint at " << file << ":" << line;
+        return false;
+    }
+
+    if (breakpoint.GetNumLocations() == 0)
+    {
+        LOG(Warning) << "Tracepoint at " << file << ":" << line
+                     << " has no locations (yet), it will trigger once its code is loaded";
+    }
+
+    auto tracepoint = std::make_unique<Tracepoint>();
+    tracepoint->owner = this;
+    tracepoint->index = uint32_t(m_tracepoints.size());
+    tracepoint->breakpoint_id = breakpoint.GetID();
+    tracepoint->location = file.substr(file.find_last_of("/\\") + 1) + ":" + std::to_string(line);
+    tracepoint->expressions = std::move(expressions);
+
+    // the expressions must be in place before lldb can call back
+    breakpoint.SetCallback(Tracepoints::on_hit, tracepoint.get());
+
+    LOG(Info) << "Set tracepoint " << tracepoint->breakpoint_id << " at " << file << ":" << line;
+    m_tracepoints.emplace_back(std::move(tracepoint));
+
+    return true;
+}
+
+void Tracepoints::remove(lldb::SBTarget& target, uint32_t index)
+{
+    Tracepoint& tracepoint = *m_tracepoints[index];
+    if (tracepoint.removed)
+    {
+        return;
+    }
+
+    target.BreakpointDelete(tracepoint.breakpoint_id);
+    tracepoint.removed = true;
+}
+
+void Tracepoints::synchronize(lldb::SBTarget& target)
+{
+    for (const std::unique_ptr<Tracepoint>& tracepoint : m_tracepoints)
+    {
+        if (!tracepoint->removed && !target.FindBreakpointByID(tracepoint->breakpoint_id).IsValid())
+        {
+            tracepoint->removed = true;
+        }
+    }
+}
+
+void Tracepoints::update()
+{
+    m_ring.drain(
+        [this](const TraceRecord& record)
+        {
+            if (m_history.size() < HISTORY_SIZE)
+            {
+                m_history.push_back(record);
+            }
+            else
+            {
+                m_history[m_history_next] = record;
+                m_history_next = (m_history_next + 1) % HISTORY_SIZE;
+            }
+            m_total_records++;
+        }
+    );
+
+    // rates are averaged over half a second, hits don't arrive evenly per frame
+    const Clock::time_point now = Clock::now();
+    const double dt = std::chrono::duration<double>(now - m_last_rate_update).count();
+    if (dt < 0.5)
+    {
+        return;
+    }
+
+    for (const std::unique_ptr<Tracepoint>& tracepoint : m_tracepoints)
+    {
+        const uint64_t hits = tracepoint->hits.load(std::memory_order_relaxed);
+        tracepoint->hits_per_second = double(hits - tracepoint->last_hits) / dt;
+        tracepoint->last_hits = hits;
+    }
+
+    m_records_per_second = double(m_total_records - m_last_total_records) / dt;
+    m_last_total_records = m_total_records;
+    m_last_rate_update = now;
+}
+
+void Tracepoints::clear_history()
+{
+    m_history.clear();
+    m_history_next = 0;
+}
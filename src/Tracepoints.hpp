@@ -0,0 +1,176 @@
+#pragma once
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One hit of a tracepoint, with its expressions' values rendered to (truncated) text.
+struct TraceRecord
+{
+    static constexpr size_t MAX_VALUES = 4;
+    static constexpr size_t VALUE_SIZE = 48;
+
+    uint64_t timestamp_ns; // since the trace buffer was created
+    uint32_t tracepoint;   // index into Tracepoints::tracepoints
+    uint32_t thread_index_id;
+    uint32_t nvalues;
+    std::array<std::array<char, VALUE_SIZE>, MAX_VALUES> values;
+};
+
+// A bounded single-producer single-consumer queue of trace records. Records
+// are dropped (and counted) rather than blocking the producer when it's full.
+class TraceRing
+{
+    static constexpr size_t CAPACITY = 8192; // must be a power of two
+
+    std::unique_ptr<TraceRecord[]> m_records = std::make_unique<TraceRecord[]>(CAPACITY);
+    alignas(64) std::atomic<uint64_t> m_write = 0;
+    alignas(64) std::atomic<uint64_t> m_read = 0;
+    std::atomic<uint64_t> m_dropped = 0;
+
+  public:
+    // Producer side: returns the slot to fill in, or nullptr if the queue is full.
+    TraceRecord* reserve()
+    {
+        const uint64_t write = m_write.load(std::memory_order_relaxed);
+        if (write - m_read.load(std::memory_order_acquire) == CAPACITY)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &m_records[write & (CAPACITY - 1)];
+    }
+
+    // Producer side: makes the slot returned by 'reserve' visible to the consumer.
+    void commit()
+    {
+        m_write.store(m_write.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer side: calls 'f(const TraceRecord&)' for every queued record.
+    template <typename F> void drain(F&& f)
+    {
+        uint64_t read = m_read.load(std::memory_order_relaxed);
+        const uint64_t write = m_write.load(std::memory_order_acquire);
+        for (; read != write; read++)
+        {
+            f(m_records[read & (CAPACITY - 1)]);
+        }
+        m_read.store(read, std::memory_order_release);
+    }
+
+    [[nodiscard]] uint64_t dropped() const
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+};
+
+class Tracepoints;
+
+struct Tracepoint
+{
+    Tracepoints* owner;
+    uint32_t index;
+    lldb::break_id_t breakpoint_id;
+    std::string location; // "file:line", for display
+    std::vector<std::string> expressions;
+    std::atomic<uint64_t> hits = 0;
+
+    // only touched by the UI thread
+    bool removed = false;
+    uint64_t last_hits = 0;
+    double hits_per_second = 0.0;
+};
+
+// Tracepoints: breakpoints whose callback records a trace record and lets the
+// process continue right away, so the UI never sees the stop.
+//
+// The callbacks run on lldb's process thread, one at a time, and push their
+// records into a lock-free ring that the UI drains once per frame into a
+// bounded history. The expressions are variable paths (e.g. 'node->next',
+// 'v[3]') read straight from the stopped frame; running the expression
+// evaluator would resume the process from within the callback and cost
+// milliseconds per hit. Tracepoints are never freed while lldb may still call
+// back into them, removing one only deletes its breakpoint.
+class Tracepoints
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<std::unique_ptr<Tracepoint>> m_tracepoints;
+    TraceRing m_ring;
+    const Clock::time_point m_epoch = Clock::now();
+
+    // only touched by the UI thread
+    std::vector<TraceRecord> m_history; // a ring of the most recent records
+    size_t m_history_next = 0;
+    uint64_t m_total_records = 0;
+    Clock::time_point m_last_rate_update = m_epoch;
+    uint64_t m_last_total_records = 0;
+    double m_records_per_second = 0.0;
+
+    static bool on_hit(
+        void* baton, lldb::SBProcess& process, lldb::SBThread& thread,
+        lldb::SBBreakpointLocation& location
+    );
+
+  public:
+    static constexpr size_t HISTORY_SIZE = 100000;
+
+    // Sets a tracepoint at 'file':'line' recording the given expressions (at
+    // most TraceRecord::MAX_VALUES of them). Returns false if lldb couldn't
+    // create the breakpoint.
+    bool add(
+        lldb::SBTarget& target, const std::string& file, uint32_t line,
+        std::vector<std::string> expressions
+    );
+
+    void remove(lldb::SBTarget& target, uint32_t index);
+
+    // Marks tracepoints whose breakpoint has been deleted (e.g. from the
+    // console) as removed.
+    void synchronize(lldb::SBTarget& target);
+
+    // Moves new records into the history and refreshes the rate counters.
+    void update();
+
+    void clear_history();
+
+    [[nodiscard]] const std::vector<std::unique_ptr<Tracepoint>>& tracepoints() const
+    {
+        return m_tracepoints;
+    }
+
+    [[nodiscard]] size_t history_size() const
+    {
+        return m_history.size();
+    }
+
+    // i = 0 is the oldest record still in the history
+    [[nodiscard]] const TraceRecord& record(size_t i) const
+    {
+        return m_history.size() < HISTORY_SIZE
+                   ? m_history[i]
+                   : m_history[(m_history_next + i) % HISTORY_SIZE];
+    }
+
+    [[nodiscard]] uint64_t total_records() const
+    {
+        return m_total_records;
+    }
+
+    [[nodiscard]] uint64_t dropped_records() const
+    {
+        return m_ring.dropped();
+    }
+
+    [[nodiscard]] double records_per_second() const
+    {
+        return m_records_per_second;
+    }
+};
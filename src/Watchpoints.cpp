@@ -0,0 +1,72 @@
+#include "Watchpoints.hpp"
+
+#include "Log.hpp"
+
+void WatchpointList::synchronize(lldb::SBTarget& target)
+{
+    if (!m_stale && target == m_target)
+    {
+        return;
+    }
+
+    m_target = target;
+    m_watchpoints.clear();
+    m_used_hardware_slots = 0;
+    m_stale = false;
+
+    if (!target.IsValid())
+    {
+        m_supported_hardware_slots = {};
+        return;
+    }
+
+    const uint32_t nwatchpoints = target.GetNumWatchpoints();
+    m_watchpoints.reserve(nwatchpoints);
+
+    for (uint32_t i = 0; i < nwatchpoints; i++)
+    {
+        lldb::SBWatchpoint watchpoint = target.GetWatchpointAtIndex(i);
+        if (!watchpoint.IsValid())
+        {
+            LOG(Warning) << "Encountered invalid watchpoint at index: " << i;
+            continue;
+        }
+
+        const char* condition = watchpoint.GetCondition();
+
+        WatchpointInfo info;
+        info.id = watchpoint.GetID();
+        info.address = watchpoint.GetWatchAddress();
+        info.size = watchpoint.GetWatchSize();
+        info.hit_count = watchpoint.GetHitCount();
+        info.ignore_count = watchpoint.GetIgnoreCount();
+        info.hardware_index = watchpoint.GetHardwareIndex();
+        info.enabled = watchpoint.IsEnabled();
+        info.condition = condition != nullptr ? std::string(condition) : std::string();
+
+        if (info.hardware_index >= 0)
+        {
+            m_used_hardware_slots++;
+        }
+
+        m_watchpoints.emplace_back(std::move(info));
+    }
+
+    // the number of hardware slots can only be queried from a live process
+    lldb::SBProcess process = target.GetProcess();
+    if (process.IsValid())
+    {
+        lldb::SBError err;
+        const uint32_t nslots = process.GetNumSupportedHardwareWatchpoints(err);
+        if (err.Success())
+        {
+            m_supported_hardware_slots = nslots;
+        }
+    }
+    else
+    {
+        m_supported_hardware_slots = {};
+    }
+
+    LOG(Verbose) << "Synchronized " << m_watchpoints.size() << " watchpoints";
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "lldb/API/LLDB.h" // IWYU pragma: keep
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A convenience struct for extracting pertinent display information from an
+// lldb::SBWatchpoint
+struct WatchpointInfo
+{
+    lldb::watch_id_t id;
+    lldb::addr_t address;
+    size_t size;
+    uint32_t hit_count;
+    uint32_t ignore_count;
+    int32_t hardware_index; // -1 if not (yet) assigned a hardware slot
+    bool enabled;
+    std::string condition;
+};
+
+// Snapshot of the target's watchpoints. Rather than querying lldb every frame,
+// the snapshot is marked stale when a watchpoint-changed event arrives (or the
+// process stops, since hit counts don't generate events) and only re-read the
+// next time it is synchronized, or when the selected target changes.
+class WatchpointList
+{
+    lldb::SBTarget m_target;
+    std::vector<WatchpointInfo> m_watchpoints;
+    std::optional<uint32_t> m_supported_hardware_slots = {};
+    uint32_t m_used_hardware_slots = 0;
+    bool m_stale = true;
+
+  public:
+    void synchronize(lldb::SBTarget& target);
+
+    void invalidate()
+    {
+        m_stale = true;
+    }
+
+    [[nodiscard]] const std::vector<WatchpointInfo>& watchpoints() const
+    {
+        return m_watchpoints;
+    }
+
+    [[nodiscard]] std::optional<uint32_t> supported_hardware_slots() const
+    {
+        return m_supported_hardware_slots;
+    }
+
+    [[nodiscard]] uint32_t used_hardware_slots() const
+    {
+        return m_used_hardware_slots;
+    }
+};
@@ -2,6 +2,7 @@
 #include "Defer.hpp"
 #include "FileSystem.hpp"
 #include "Log.hpp"
+#include "LogSink.hpp"
 #include "StringBuffer.hpp"
 #include "cxxopts.hpp"
 
@@ -28,6 +29,9 @@ int main(int argc, char** argv)
             ("s,source", "Tells the debugger to read in and execute the lldb commands in the given file, after any file has been loaded.", cxxopts::value<std::string>())
             ("workdir", "Specify base directory of file explorer tree", cxxopts::value<std::string>())
             ("loglevel", "Set the log level (debug, verbose, info, warning, error)", cxxopts::value<std::string>())
+            ("logfile", "Also write the log to the given file, rotated once it grows past 16 MB", cxxopts::value<std::string>())
+            ("log-stderr", "Also print all log messages to stderr")
+            ("console-history-mb", "Limit the console history kept in memory to the given size in MB (default: 64)", cxxopts::value<size_t>())
             ("h,help", "Print out usage information.")
             ("positional", "Positional arguments: these are the arguments that are entered without an option", cxxopts::value<std::vector<std::string>>())
             ;
@@ -72,8 +76,40 @@ int main(int argc, char** argv)
                 return EXIT_FAILURE;
             }
             LOG(Verbose) << "Setting log level to: " << loglevel;
+
+            if (Logger::get_instance()->get_log_level() > (int) COMPILED_LOG_LEVEL)
+            {
+                LOG(Warning) << "This build was compiled without log messages more detailed than "
+                             << log_level_name(COMPILED_LOG_LEVEL) << ", see LLDBG_LOG_LEVEL";
+            }
+        }
+
+        bool has_log_sinks = false;
+        if (result.count("logfile") > 0)
+        {
+            auto sink = std::make_unique<FileSink>(
+                result["logfile"].as<std::string>(), 16 * 1024 * 1024, 4
+            );
+            if (sink->is_open())
+            {
+                Logger::get_instance()->add_sink(std::move(sink));
+                has_log_sinks = true;
+            }
+        }
+
+        if (result.count("log-stderr") > 0)
+        {
+            Logger::get_instance()->add_sink(std::make_unique<StderrSink>());
+            has_log_sinks = true;
         }
 
+        if (has_log_sinks)
+        {
+            Logger::get_instance()->start_writer();
+            Logger::get_instance()->install_crash_handler();
+        }
+        Defer(Logger::get_instance()->shutdown());
+
         if (auto lldb_error = lldb::SBDebugger::InitializeWithErrorHandling();
             !lldb_error.Success())
         {
@@ -103,6 +139,17 @@ int main(int argc, char** argv)
 
         Application app(*ui, workdir);
 
+        if (const std::optional<fs::path> history_path = CommandHistory::default_path())
+        {
+            app.command_history.open(*history_path);
+        }
+
+        if (result.count("console-history-mb") > 0)
+        {
+            const size_t megabytes = result["console-history-mb"].as<size_t>();
+            app.cmdline.get_history().set_max_bytes(megabytes * 1024 * 1024);
+        }
+
         if (result.count("source-before-file") > 0)
         {
             const std::string source_path = result["source-before-file"].as<std::string>();